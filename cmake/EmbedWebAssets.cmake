@@ -0,0 +1,121 @@
+# Compiles the web/ tree into a C++ source of byte arrays, run at build time:
+#   cmake -DWEB_DIR=<web> -DOUTPUT=<file.cpp> [-DGZIP=<gzip>] [-DBROTLI=<brotli>] -P EmbedWebAssets.cmake
+# Files under static/ get a content-hashed URL and templates are rewritten to reference it.
+# Precompressed variants are only kept when they are smaller than the original.
+
+get_filename_component(work_dir "${OUTPUT}" DIRECTORY)
+set(work_dir "${work_dir}/web_assets")
+file(MAKE_DIRECTORY "${work_dir}")
+
+file(GLOB_RECURSE files RELATIVE "${WEB_DIR}" "${WEB_DIR}/*")
+list(SORT files)
+
+# First pass: hashed URLs for everything under static/
+set(rewrites "")
+foreach(rel IN LISTS files)
+    if(rel MATCHES "^static/")
+        file(SHA256 "${WEB_DIR}/${rel}" hash)
+        string(SUBSTRING "${hash}" 0 12 short)
+        string(REGEX REPLACE "\\.([^./]+)$" ".${short}.\\1" hashed "${rel}")
+        set(url_${hash} "/${hashed}")
+        set(hashed_url_${rel} "/${hashed}")
+        list(APPEND rewrites "${rel}")
+    endif()
+endforeach()
+
+function(content_type rel out)
+    if(rel MATCHES "\\.html?$")
+        set(type "text/html; charset=utf-8")
+    elseif(rel MATCHES "\\.css$")
+        set(type "text/css; charset=utf-8")
+    elseif(rel MATCHES "\\.js$")
+        set(type "application/javascript; charset=utf-8")
+    elseif(rel MATCHES "\\.json$")
+        set(type "application/json")
+    elseif(rel MATCHES "\\.svg$")
+        set(type "image/svg+xml")
+    elseif(rel MATCHES "\\.png$")
+        set(type "image/png")
+    elseif(rel MATCHES "\\.ico$")
+        set(type "image/x-icon")
+    else()
+        set(type "application/octet-stream")
+    endif()
+    set(${out} "${type}" PARENT_SCOPE)
+endfunction()
+
+# CMake regexes have no {n} quantifier, so spell out one row of 24 bytes
+set(row_pattern "")
+foreach(i RANGE 1 24)
+    string(APPEND row_pattern "0x..,")
+endforeach()
+
+function(byte_array name file out)
+    file(READ "${file}" hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(${row_pattern})" "\\1\n    " bytes "${bytes}")
+    set(${out} "constexpr unsigned char ${name}[] = {\n    ${bytes}0x00\n};\n" PARENT_SCOPE)
+endfunction()
+
+set(arrays "")
+set(entries "")
+set(index 0)
+foreach(rel IN LISTS files)
+    set(source "${WEB_DIR}/${rel}")
+
+    # Templates point at the hashed URLs so browsers can cache assets forever
+    if(rel MATCHES "^templates/")
+        file(READ "${source}" text)
+        foreach(asset IN LISTS rewrites)
+            string(REPLACE "\"/${asset}\"" "\"${hashed_url_${asset}}\"" text "${text}")
+        endforeach()
+        set(source "${work_dir}/asset${index}")
+        file(WRITE "${source}" "${text}")
+    endif()
+
+    file(SIZE "${source}" size)
+    file(SHA256 "${source}" hash)
+    string(SUBSTRING "${hash}" 0 16 etag)
+    content_type("${rel}" type)
+    if(DEFINED hashed_url_${rel})
+        set(url "${hashed_url_${rel}}")
+    else()
+        set(url "/${rel}")
+    endif()
+
+    byte_array("asset${index}" "${source}" array)
+    string(APPEND arrays "${array}")
+
+    set(gzip_ref "nullptr, 0")
+    if(GZIP)
+        execute_process(COMMAND "${GZIP}" -9 -n -c "${source}" OUTPUT_FILE "${work_dir}/asset${index}.gz" RESULT_VARIABLE rc)
+        file(SIZE "${work_dir}/asset${index}.gz" gzip_size)
+        if(rc EQUAL 0 AND gzip_size LESS size)
+            byte_array("asset${index}_gz" "${work_dir}/asset${index}.gz" array)
+            string(APPEND arrays "${array}")
+            set(gzip_ref "asset${index}_gz, ${gzip_size}")
+        endif()
+    endif()
+
+    set(brotli_ref "nullptr, 0")
+    if(BROTLI)
+        execute_process(COMMAND "${BROTLI}" -q 11 -c "${source}" OUTPUT_FILE "${work_dir}/asset${index}.br" RESULT_VARIABLE rc)
+        file(SIZE "${work_dir}/asset${index}.br" brotli_size)
+        if(rc EQUAL 0 AND brotli_size LESS size)
+            byte_array("asset${index}_br" "${work_dir}/asset${index}.br" array)
+            string(APPEND arrays "${array}")
+            set(brotli_ref "asset${index}_br, ${brotli_size}")
+        endif()
+    endif()
+
+    string(APPEND entries "    {\"${rel}\", \"${url}\", \"${type}\", \"\\\"${etag}\\\"\", asset${index}, ${size}, ${gzip_ref}, ${brotli_ref}},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(content "// Generated by cmake/EmbedWebAssets.cmake from web/, do not edit\n#include \"utils/WebAssets.h\"\n\nnamespace {\n\n${arrays}\n}\n\n")
+string(APPEND content "extern const EmbeddedAsset kEmbeddedAssets[] = {\n${entries}};\n\n")
+string(APPEND content "extern const size_t kEmbeddedAssetCount = ${index};\n")
+
+# Only touch the output when something changed so unrelated builds don't recompile it
+file(WRITE "${OUTPUT}.tmp" "${content}")
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+#include <memory>
+#include "controllers/JsonResponse.h"
+#include "utils/BlockingExecutor.h"
+#include "utils/Logger.h"
+
+using namespace drogon;
+
+inline HttpResponsePtr blockingErrorResponse(const std::string& message, HttpStatusCode status) {
+    JsonWriter json;
+    json.beginObject().field("status", "error").field("message", message).endObject();
+    return jsonResponse(json, status);
+}
+
+// Runs a handler body on the BlockingExecutor and returns the IO thread to Drogon straight away.
+// When the operation class is saturated the client gets an immediate 429 with Retry-After, and once
+// a shutdown drain has begun a 503. Every accepted request is answered: a throwing handler with a
+// 500, one dropped at shutdown with a 503.
+inline void runBlocking(const std::string& opClass, std::function<void(const HttpResponsePtr&)>&& callback,
+                        std::function<HttpResponsePtr()> work) {
+    auto respond = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    auto& executor = BlockingExecutor::getInstance();
+    auto run = [respond, work, opClass]() {
+        HttpResponsePtr resp;
+        try {
+            resp = work();
+        } catch (const std::exception& e) {
+            MAESTRO_LOG_ERROR("{} request failed: {}", opClass, e.what());
+        } catch (...) {
+            MAESTRO_LOG_ERROR("{} request failed with a non-standard exception", opClass);
+        }
+        (*respond)(resp ? resp : blockingErrorResponse("Internal error while handling the request", k500InternalServerError));
+    };
+    auto shuttingDown = [respond]() {
+        auto resp = blockingErrorResponse("Server is shutting down", k503ServiceUnavailable);
+        resp->addHeader("Retry-After", "5");
+        (*respond)(resp);
+    };
+    if (executor.submit(opClass, std::move(run), shuttingDown)) {
+        return;
+    }
+    if (executor.isDraining()) {
+        shuttingDown();
+        return;
+    }
+
+    auto resp = blockingErrorResponse("Too many " + opClass + " requests in progress, try again shortly",
+                                      k429TooManyRequests);
+    resp->addHeader("Retry-After", std::to_string(executor.retryAfterSeconds(opClass)));
+    (*respond)(resp);
+}
@@ -33,4 +33,10 @@ public:
     
     void index(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void captiveDetect(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // Response for a file from the compiled-in web bundle, or nullptr to fall through to routing
+    static HttpResponsePtr serveEmbeddedAsset(const HttpRequestPtr& req);
+
+    // CaptiveSessions key for the requesting client; address is set to its textual IP
+    static uint64_t clientKey(const HttpRequestPtr& req, std::string& address);
 };
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+using namespace drogon;
+
+class DiagnosticsController : public HttpController<DiagnosticsController> {
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(DiagnosticsController::getStartupTimeline, "/api/diagnostics/startup", Get);
+    ADD_METHOD_TO(DiagnosticsController::getConnectAttempts, "/api/diagnostics/connect", Get);
+    ADD_METHOD_TO(DiagnosticsController::getTrace, "/api/diagnostics/trace", Get);
+    ADD_METHOD_TO(DiagnosticsController::updateTrace, "/api/diagnostics/trace", Post);
+    ADD_METHOD_TO(DiagnosticsController::getCaptiveSessions, "/api/diagnostics/captive", Get);
+    ADD_METHOD_TO(DiagnosticsController::getMetrics, "/metrics", Get);
+    METHOD_LIST_END
+
+    void getStartupTimeline(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getConnectAttempts(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getTrace(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    // {"enable": bool, "clear": bool}, either optional; GET stays a read-only dump
+    void updateTrace(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getCaptiveSessions(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getMetrics(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+};
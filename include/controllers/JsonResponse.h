@@ -0,0 +1,16 @@
+#pragma once
+
+#include <drogon/HttpResponse.h>
+#include "utils/JsonWriter.h"
+
+using namespace drogon;
+
+// Response carrying what a JsonWriter produced. The body is a single copy of the buffer, which
+// then returns to the thread's pool when the writer goes out of scope.
+inline HttpResponsePtr jsonResponse(const JsonWriter& json, HttpStatusCode code = k200OK) {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(code);
+    resp->setContentTypeCode(CT_APPLICATION_JSON);
+    resp->setBody(json.str());
+    return resp;
+}
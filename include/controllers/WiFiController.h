@@ -1,6 +1,8 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include "services/WiFiManagerService.h"
+#include "utils/JsonWriter.h"
 
 using namespace drogon;
 
@@ -8,6 +10,7 @@ class WiFiController : public HttpController<WiFiController> {
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(WiFiController::scanNetworks, "/api/wifi/scan", Get);
+    ADD_METHOD_TO(WiFiController::getScanSchedule, "/api/wifi/scan/schedule", Get);
     ADD_METHOD_TO(WiFiController::connectToNetwork, "/api/wifi/connect", Post);
     ADD_METHOD_TO(WiFiController::getStatus, "/api/wifi/status", Get);
     ADD_METHOD_TO(WiFiController::disconnect, "/api/wifi/disconnect", Post);
@@ -16,9 +19,18 @@ public:
     METHOD_LIST_END
 
     void scanNetworks(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getScanSchedule(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void connectToNetwork(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void getStatus(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void disconnect(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void validateConnectivity(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void resetNetwork(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // Body of a cached-scan response at the given version token
+    static void writeScanResponse(JsonWriter& json, const std::vector<WiFiNetwork>& networks, const std::string& version);
+    // One scan entry; "id" is what delta responses use to match added, changed and removed entries
+    static void writeNetwork(JsonWriter& json, const WiFiNetwork& network);
+
+private:
+    static HttpResponsePtr resetNetworkResponse();
 };
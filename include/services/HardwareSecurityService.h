@@ -1,11 +1,58 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+struct evp_pkey_st;
+
+// What a license token asserts, once its signature has been checked
+struct LicenseVerdict {
+    bool licensed = false;
+    std::string fingerprint;
+    int64_t issuedAt = 0;  // epoch seconds
+    int64_t expiresAt = 0; // epoch seconds
+};
+
+// Offline license checks: tokens are verified locally against a bundled public key and the last
+// good one is cached on disk, so neither boot nor request handling waits on the license server.
 class HardwareSecurityService {
 public:
     static HardwareSecurityService& getInstance();
+
+    // Hashes the hardware fingerprint, loads the public key and the cached token, then starts
+    // the background refresh. Never touches the network.
     bool initialize();
+
+    // Reads the in-memory verdict; always true when ENABLE_HARDWARE_SECURITY is off
     bool validateLicense();
-    
+
+    LicenseVerdict getVerdict();
+    const std::string& getFingerprint() const { return fingerprint; }
+
+    // token is "<base64url payload>.<base64url signature>". True only when the signature checks out
+    // against the public key and the payload names this device; verdict is filled in on success.
+    bool verifyToken(const std::string& token, LicenseVerdict& verdict);
+
+    // SHA-256 over board serial, CPU identity and the permanent MACs of physical interfaces, as hex
+    static std::string computeFingerprint();
+
 private:
     HardwareSecurityService() = default;
+    bool loadPublicKey(const std::string& path);
+    // Verifies and adopts token unless it was issued before the current verdict
+    bool acceptToken(const std::string& token, bool persist);
+    bool refreshFromServer();
+    void refreshLoop();
+
+    bool enabled = false;
+    std::string fingerprint;
+    evp_pkey_st* publicKey = nullptr;
+    std::string cachePath;
+
+    // Epoch second the current verdict stops being valid; 0 when unlicensed
+    std::atomic<int64_t> licensedUntil{0};
+    std::mutex verdictMutex;
+    LicenseVerdict verdict;
 };
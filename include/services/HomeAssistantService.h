@@ -1,14 +1,63 @@
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where the ahead-of-time image pull and container creation stand
+struct HomeAssistantPrepareStatus {
+    std::string state = "idle"; // idle, pulling, creating, ready, failed
+    std::string trigger;        // what started the last preparation
+    std::string detail;         // failure reason, or a note such as a pull that fell back to the local image
+    int64_t elapsedMs = 0;      // of the current or last preparation
+    bool startPending = false;  // start() was called; the container starts as soon as preparation ends
+};
+
+enum class HomeAssistantStart {
+    Started,
+    Failed,
+    Pending // still being prepared; it starts in the background once the image and container are there
+};
+
 class HomeAssistantService {
 public:
     static HomeAssistantService& getInstance();
     bool initialize();
-    bool start();
+    // Only starts the container inline once it is prepared, so a multi-GB pull never holds the caller
+    HomeAssistantStart start();
     bool stop();
     bool isRunning();
-    
+
+    // Pulls the image and creates the container without starting it, on a background thread with
+    // dockerd and containerd at a low cgroup weight, so start() only has to start it. No-op while one
+    // is running or once ready.
+    void prepareAsync(const std::string& trigger);
+    HomeAssistantPrepareStatus getPrepareStatus();
+
+    // Background check that prepares Home Assistant ("idle" trigger) whenever the device is quiet:
+    // no portal work in flight and a low load average
+    void startIdlePreparation();
+
 private:
     HomeAssistantService() = default;
+    // Caller holds prepareMutex; false when a preparation is already running
+    bool beginPrepare(const std::string& trigger, bool throttled);
+    void prepare(bool throttled);
+    void idleLoop();
+    std::string composeCommand(const std::string& args);
+    // Lowers the docker units' CPUWeight/IOWeight, or puts back what they had before
+    void throttleDocker(bool throttle);
+
     bool initialized = false;
+
+    std::mutex prepareMutex;
+    bool preparing = false;
+    bool startWhenPrepared = false;
+    HomeAssistantPrepareStatus prepareStatus;
+    int64_t prepareStartedMs = 0;
+
+    std::mutex throttleMutex;
+    std::vector<std::pair<std::string, std::string>> savedWeights; // unit -> set-property arguments restoring it
 };
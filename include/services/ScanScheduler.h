@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "utils/HostapdControl.h"
+
+// What a full-scan request was told: which run will cover it and roughly when that starts
+struct FullScanTicket {
+    uint64_t run = 0;        // completes once getStatus().completedRuns reaches this
+    int64_t etaMs = 0;       // estimated wait before the scan starts; 0 when it starts now or is running
+    std::string waitingFor;  // "", "running", "min_interval" or "active_stations"
+};
+
+struct ScanSchedulerStatus {
+    bool pending = false;
+    bool running = false;
+    bool forced = false;
+    uint64_t completedRuns = 0;
+    int64_t etaMs = 0;
+    std::string waitingFor;
+    int stations = 0;
+    int activeStations = 0;
+    int64_t lastRunAgoMs = -1; // -1 before the first run
+};
+
+// Full scans take the hotspot down, so they are queued here rather than run on request. Requests
+// coalesce into one pending run, which starts once FULL_SCAN_MIN_INTERVAL_SEC has passed since the
+// last one and no station on the AP has been active for FULL_SCAN_STATION_IDLE_SEC. Stations come
+// from hostapd's control interface; the requesting phones' own stations don't count, and force
+// skips the station check altogether.
+class ScanScheduler {
+public:
+    static ScanScheduler& getInstance();
+
+    // Starts the worker and the hostapd event monitor
+    void start();
+    // No new runs start after this; a run already in progress finishes on the executor
+    void stop();
+
+    // requesterMac, when known, is the station asking; it is exempt from the activity check
+    FullScanTicket request(const std::string& trigger, bool force, const std::string& requesterMac = "");
+    // True once the given run has completed; false on timeout
+    bool waitForRun(uint64_t run, std::chrono::milliseconds timeout);
+
+    ScanSchedulerStatus getStatus();
+
+private:
+    ScanScheduler();
+    void workerLoop();
+    // Milliseconds until the pending run may start (0 = now); reason says what it waits on
+    int64_t evaluate(int64_t nowMs, std::string& reason);
+    void refreshStations(int64_t nowMs);
+    void onStationEvent(const std::string& event, const std::string& mac);
+    void runFullScan();
+
+    int64_t minIntervalMs;
+    int64_t stationIdleMs;
+    int64_t recheckMs;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool started = false;
+    bool stopping = false;
+    bool pending = false;
+    bool running = false;
+    bool forced = false;
+    std::set<std::string> exempt;
+    std::string trigger;
+    uint64_t completedRuns = 0;
+    int64_t lastRunEndMs = 0; // steady clock; 0 before the first run
+
+    // Last hostapd view, keyed by MAC, with the steady time each inactivity reading was taken
+    struct StationSeen {
+        int64_t inactiveMs = 0;
+        int64_t observedAtMs = 0;
+    };
+    std::map<std::string, StationSeen> stations;
+    int64_t stationsRefreshedMs = 0;
+    int64_t requestedAtMs = 0;
+    int64_t etaMs = 0;
+    int64_t etaComputedMs = 0;
+    std::string waitingFor;
+};
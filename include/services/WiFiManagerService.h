@@ -2,18 +2,72 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <deque>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "utils/WiFiUtils.h"
 
 struct WiFiNetwork {
     std::string ssid;
     int signal;
     std::string security;
+    std::string bssid;
+    int frequency = 0;
 };
 
 struct WiFiStatus {
     bool connected;
     std::string ssid;
-    int signal;
+    int signal; // 0-100, from the averaged signal when the driver provides one
+    LinkStats link;
+};
+
+// Last network that associated successfully, persisted across boots
+struct LastNetwork {
+    std::string ssid;
+    std::string bssid;
+    int frequency = 0;
+    bool validated = false;
+};
+
+// One step of a connect attempt; times are relative to the start of the attempt
+struct ConnectPhase {
+    std::string name;
+    double startMs = 0.0;
+    double durationMs = 0.0;
+    bool ok = true;
+    std::string detail;
+};
+
+struct ConnectAttempt {
+    uint64_t id = 0;
+    std::string ssid;
+    int64_t startedAtEpochMs = 0;
+    double totalMs = 0.0;
+    bool success = false;
+    std::string failedPhase;
+    std::vector<ConnectPhase> phases;
+};
+
+// Difference between two scan cache versions; entries are matched by WiFiManagerService::networkId
+struct ScanDelta {
+    uint64_t fromVersion = 0;
+    uint64_t toVersion = 0;
+    std::vector<WiFiNetwork> added;
+    std::vector<WiFiNetwork> changed;
+    std::vector<std::string> removed;
+};
+
+// Rolling view of one BSS across scans
+struct TrackedNetwork {
+    WiFiNetwork network;
+    double smoothedSignal = 0.0;
+    std::chrono::steady_clock::time_point firstSeen;
+    std::chrono::steady_clock::time_point lastSeen;
+    int consecutiveMisses = 0;
 };
 
 class WiFiManagerService {
@@ -21,15 +75,56 @@ public:
     static WiFiManagerService& getInstance();
 
     bool initialize();
-    std::vector<WiFiNetwork> scanNetworks(bool full_scan = false);
+    // version, when given, receives the cache version the returned list belongs to
+    std::vector<WiFiNetwork> scanNetworks(bool full_scan = false, uint64_t* version = nullptr);
+    // True once a cached (non-full) scan can be answered without touching the radio
+    bool hasCachedNetworks();
+    // Changes from an earlier cache version to the current one; false when that version has aged out
+    // of the last SCAN_HISTORY_SIZE snapshots (or never existed) and the client needs the full list
+    bool getScanDelta(uint64_t since, ScanDelta& delta);
+    // Stable identity of a scan entry: the BSSID, or the SSID when the scanner didn't report one
+    static const std::string& networkId(const WiFiNetwork& network);
     bool connectToNetwork(const std::string& ssid, const std::string& password);
     WiFiStatus getConnectionStatus();
     bool disconnect();
     bool validateInternetConnectivity();
 
+    // Most recent connect attempts (CONNECT_HISTORY_SIZE), newest first
+    std::vector<ConnectAttempt> getRecentConnectAttempts();
+
+    // Boot fast path: targeted reconnect to the last validated network before falling back to the hotspot
+    bool reconnectLastNetwork();
+
+    // Folds the results of scans started by anyone else (wpa_supplicant, hostapd, the kernel) into
+    // the cache as nl80211 announces them, so the list stays fresh without scans of our own
+    void startPassiveScanHarvest();
+
 private:
     WiFiManagerService() = default;
+    // countMisses is off for harvested results, whose scans may have been directed at one SSID
+    void aggregateScanResults(const std::vector<WiFiScanResult>& results, bool full_scan, bool countMisses = true);
+    void harvestScanResults(const std::string& interface);
+    void recordConnectAttempt(ConnectAttempt attempt);
+    bool loadLastNetwork(LastNetwork& record);
+    void saveLastNetwork(const LastNetwork& record);
+
     bool initialized = false;
     std::vector<WiFiNetwork> cachedNetworks;
+    uint64_t cacheVersion = 0;
+    struct ScanSnapshot {
+        uint64_t version;
+        std::vector<WiFiNetwork> networks;
+    };
+    std::deque<ScanSnapshot> scanHistory;
+    std::map<std::string, TrackedNetwork> networkTable;
     std::mutex cacheMutex;
+    std::atomic<bool> firstScanAvailable{false};
+    // Our own scans raise NEW_SCAN_RESULTS too; those results are already in the cache
+    std::atomic<int> ownScansRunning{0};
+    std::atomic<int64_t> lastOwnScanEndMs{0};
+
+    std::vector<ConnectAttempt> connectHistory;
+    size_t connectHistoryNext = 0;
+    uint64_t nextAttemptId = 1;
+    std::mutex historyMutex;
 };
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Worker pool for operations that block on the radio or spawn tools, kept off Drogon's IO threads.
+// Each operation class ("scan", "full_scan", "connect", "validate", "service", "status") has its own
+// concurrency limit (EXEC_LIMIT_<CLASS>) and queue cap (EXEC_QUEUE_<CLASS>).
+class BlockingExecutor {
+public:
+    static BlockingExecutor& getInstance();
+
+    void start();
+    void stop();
+
+    // False when the class queue is full or a drain has begun; the caller should shed the request. A
+    // task still queued when stop() runs is discarded and onDropped is called instead, so its caller
+    // can still answer.
+    bool submit(const std::string& opClass, std::function<void()> task, std::function<void()> onDropped = nullptr);
+
+    // Rough seconds until a rejected caller would get a slot, from queue depth and recent durations
+    int retryAfterSeconds(const std::string& opClass);
+
+    // Blocks until nothing is queued or running, or timeout passes; false on timeout
+    bool waitIdle(std::chrono::milliseconds timeout);
+
+    // From here on submit refuses new work, so waitIdle converges while the listeners are still open
+    void beginDrain();
+    bool isDraining();
+
+private:
+    BlockingExecutor() = default;
+    ~BlockingExecutor();
+
+    struct QueuedTask {
+        std::function<void()> run;
+        std::function<void()> dropped;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct OperationClass {
+        std::string name;
+        int limit = 1;
+        size_t queueCap = 4;
+        int running = 0;
+        double avgSeconds = 1.0;
+        std::deque<QueuedTask> queue;
+    };
+
+    OperationClass& operationClass(const std::string& name);
+    bool takeNext(OperationClass*& opClass, QueuedTask& task);
+    void workerLoop();
+
+    std::map<std::string, OperationClass> classes;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable idle;
+    size_t nextClass = 0;
+    bool stopping = false;
+    bool draining = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class CaptiveState : uint8_t {
+    Probing = 0,      // only OS connectivity probes seen so far
+    PortalViewed = 1, // the portal page has been loaded
+    Complete = 2,     // setup finished for this client; probes get the real "online" answer
+};
+
+struct CaptiveSession {
+    std::string address;
+    std::string mac; // from the ARP table when the client was first seen; empty if unknown
+    CaptiveState state = CaptiveState::Probing;
+    uint32_t probes = 0;
+    uint32_t portalViews = 0;
+    int64_t firstSeenMs = 0; // steady clock
+    int64_t lastSeenMs = 0;
+};
+
+// Per-client captive state in a fixed-capacity open-addressing table (CAPTIVE_SESSION_CAPACITY).
+// A client hashes to a short window of slots; when the window is full the least recently seen
+// entry in it is reused. Lookups and counter updates are lock-free; claiming a slot for a new client
+// and changing a client's state take the mutex, and a slot's sequence is odd while it is being reset
+// for its new owner. An address that shows up with a different MAC gets a fresh slot, so a recycled
+// DHCP lease doesn't inherit the previous phone's state.
+class CaptiveSessions {
+public:
+    static CaptiveSessions& getInstance();
+
+    // Table key for a client: the IPv4 address, or a hash of the textual address for IPv6
+    static uint64_t keyFor(const std::string& address, uint32_t ipv4NetEndian, bool ipv6);
+
+    // Record one connectivity probe / portal page load and return the client's state afterwards
+    CaptiveState recordProbe(uint64_t key, const std::string& address);
+    CaptiveState recordPortalView(uint64_t key, const std::string& address);
+
+    // MAC from the ARP table when the client was first seen; empty if unknown or not tracked
+    std::string clientMac(uint64_t key);
+
+    void markComplete(uint64_t key, const std::string& address);
+    // Setup is over for everyone, including clients not seen yet (hotspot shut down)
+    void markAllComplete();
+    // Back to captive mode (network reset)
+    void clear();
+
+    std::vector<CaptiveSession> snapshot();
+    size_t capacity() const { return slotCount; }
+
+private:
+    CaptiveSessions();
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> sequence{0}; // odd while the slot is being reassigned
+        std::atomic<uint64_t> key{0};      // 0 = never used
+        std::atomic<uint8_t> state{0};
+        std::atomic<uint32_t> probes{0};
+        std::atomic<uint32_t> portalViews{0};
+        std::atomic<int64_t> firstSeenMs{0};
+        std::atomic<int64_t> lastSeenMs{0};
+        std::atomic<uint64_t> mac{0};
+        char address[46] = {};
+    };
+
+    Slot* find(uint64_t key, int64_t nowMs);
+    // sequence is the slot's (even) sequence for this owner; it changes if the slot is re-claimed
+    Slot& findOrClaim(uint64_t key, const std::string& address, int64_t nowMs, uint32_t& sequence);
+
+    size_t slotCount;
+    size_t window;
+    int64_t idleMs;
+    std::unique_ptr<Slot[]> slots;
+    std::mutex claimMutex;
+    std::atomic<bool> setupComplete{false};
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One associated station as hostapd reports it
+struct ApStation {
+    std::string mac;
+    int64_t inactiveMs = 0;      // since the last frame from the station
+    int64_t connectedSeconds = 0;
+};
+
+// Client for hostapd's control interface (HOSTAPD_CTRL_DIR/<NETWORK_INTERFACE>), the same
+// datagram protocol hostapd_cli speaks. Station queries go over a persistent socket; when that
+// socket isn't there they fall back to `hostapd_cli`. Services reach it through SystemBackend.
+class HostapdControl {
+public:
+    static HostapdControl& getInstance();
+
+    // STA-FIRST / STA-NEXT walk of the associated stations; false when hostapd isn't answering
+    bool listStations(std::vector<ApStation>& stations);
+
+    // ATTACHes a second socket on a background thread and calls onEvent(event, mac) for every
+    // AP-STA-CONNECTED / AP-STA-DISCONNECTED, reattaching whenever hostapd restarts
+    void startEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent);
+
+    // STA / `hostapd_cli all_sta` output: a MAC line followed by key=value lines, per station
+    static std::vector<ApStation> parseStations(const std::string& output);
+
+private:
+    HostapdControl();
+    ~HostapdControl();
+    HostapdControl(const HostapdControl&) = delete;
+    HostapdControl& operator=(const HostapdControl&) = delete;
+
+    int openSocket(std::string& localPath);
+    bool request(const std::string& command, std::string& reply);
+    void closeSocket();
+    void eventLoop(std::function<void(const std::string&, const std::string&)> onEvent);
+
+    std::string interface;
+    std::string controlPath;
+
+    // Request socket, reused across queries; the mutex keeps replies from interleaving
+    std::mutex mutex;
+    int fd = -1;
+    std::string localPath;
+    std::atomic<bool> monitoring{false};
+};
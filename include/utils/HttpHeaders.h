@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Parsing for the request headers that conditional and content-negotiated responses depend on
+class HttpHeaders {
+public:
+    // If-None-Match against one entity tag; weak comparison, so a W/ prefix on either side is ignored
+    static bool etagMatches(const std::string& ifNoneMatch, const std::string& etag);
+
+    // True when Accept-Encoding lists coding, or "*" without listing it, with a q-value above zero
+    static bool acceptsEncoding(const std::string& acceptEncoding, const std::string& coding);
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+// Writes compact JSON straight into a buffer, for responses whose shape is fixed by the code that
+// writes them: no DOM, no per-field allocation. Buffers come from a small per-thread pool and go
+// back to it, capacity intact, when the writer is destroyed. Commas are placed automatically;
+// strings are escaped, and bytes that aren't valid UTF-8 become U+FFFD so SSIDs can't break the output.
+//
+//   JsonWriter json;
+//   json.beginObject().field("status", "success").key("networks").beginArray();
+//   ...
+//   json.endArray().endObject();
+class JsonWriter {
+public:
+    JsonWriter();
+    ~JsonWriter();
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(const char* name);
+    JsonWriter& key(const std::string& name);
+
+    JsonWriter& value(const char* text);
+    JsonWriter& value(const std::string& text);
+    JsonWriter& value(bool flag);
+    JsonWriter& value(double number);
+    JsonWriter& null();
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, JsonWriter&>::type
+    value(T number) {
+        return std::is_signed<T>::value ? signedInteger(static_cast<int64_t>(number))
+                                        : unsignedInteger(static_cast<uint64_t>(number));
+    }
+
+    template <typename T>
+    JsonWriter& field(const char* name, const T& fieldValue) {
+        return key(name).value(fieldValue);
+    }
+    JsonWriter& field(const char* name, const char* text) { return key(name).value(text); }
+
+    const std::string& str() const { return *buffer; }
+
+    // Appends text to a JSON string literal being built by hand (without the quotes)
+    static void appendEscaped(std::string& out, const char* data, size_t size);
+
+private:
+    void separate();
+    JsonWriter& signedInteger(int64_t number);
+    JsonWriter& unsignedInteger(uint64_t number);
+
+    std::unique_ptr<std::string> buffer;
+    uint64_t nonEmpty = 0; // bit per nesting level: something has been written at that level
+    int depth = 0;
+    bool afterKey = false;
+};
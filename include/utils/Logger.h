@@ -2,9 +2,13 @@
 #include <string>
 #include <fstream>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <type_traits>
 
 class Logger {
 public:
@@ -18,23 +22,84 @@ public:
     static Logger& getInstance();
     void setLogFile(const std::string& filepath);
     void setLevel(Level level);
+    bool enabled(Level level) const { return level >= minLevel.load(std::memory_order_relaxed); }
 
     void debug(const std::string& message);
     void info(const std::string& message);
     void warning(const std::string& message);
     void error(const std::string& message);
 
+    // Fills each "{}" in format with the next argument, into a per-thread buffer. Call it through
+    // MAESTRO_LOG_* so the arguments aren't even evaluated when the level is filtered out.
+    template <typename... Args>
+    void logf(Level level, const char* format, const Args&... args) {
+        std::string& line = formatBuffer();
+        line.clear();
+        formatInto(line, format, args...);
+        log(level, line);
+    }
+
+    // Callers currently blocked on or writing a log line
+    int getQueueDepth() const { return pendingWrites.load(std::memory_order_relaxed); }
+
 private:
-    Logger() : minLevel(INFO) {}
+    Logger() = default;
     void log(Level level, const std::string& message);
     void openDailyLogFile();
     void cleanupOldLogs();
-    std::string getLevelString(Level level);
-    std::string getCurrentTime();
+    void refreshTimestamp();
+    const char* getLevelString(Level level);
+
+    static std::string& formatBuffer();
+    static void formatInto(std::string& out, const char* format) { out += format; }
+    template <typename T, typename... Rest>
+    static void formatInto(std::string& out, const char* format, const T& first, const Rest&... rest) {
+        const char* placeholder = std::strstr(format, "{}");
+        if (!placeholder) {
+            out += format;
+            return;
+        }
+        out.append(format, static_cast<size_t>(placeholder - format));
+        appendArg(out, first);
+        formatInto(out, placeholder + 2, rest...);
+    }
+
+    static void appendArg(std::string& out, const std::string& text) { out += text; }
+    static void appendArg(std::string& out, const char* text) { out += text ? text : "(null)"; }
+    static void appendArg(std::string& out, char c) { out += c; }
+    static void appendArg(std::string& out, bool flag) { out += flag ? "true" : "false"; }
+    static void appendArg(std::string& out, double number);
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value>::type appendArg(std::string& out, T number) {
+        if (std::is_signed<T>::value) appendSigned(out, static_cast<int64_t>(number));
+        else appendUnsigned(out, static_cast<uint64_t>(number));
+    }
+    static void appendSigned(std::string& out, int64_t number);
+    static void appendUnsigned(std::string& out, uint64_t number);
 
     std::ofstream logFile;
     std::mutex logMutex;
-    Level minLevel;
+    std::atomic<int> minLevel{INFO};
     std::string baseLogPath;
     std::string currentLogDate;
+    std::atomic<int> pendingWrites{0};
+
+    // "YYYY-MM-DD HH:MM:SS" for cachedSecond; localtime runs only when the second changes
+    std::time_t cachedSecond = 0;
+    char cachedTimestamp[20] = {};
+    std::string lineBuffer;
 };
+
+// Level check first; the format arguments are evaluated only for lines that will be written
+#define MAESTRO_LOG(level, ...)                                          \
+    do {                                                                 \
+        Logger& maestroLogger_ = Logger::getInstance();                  \
+        if (maestroLogger_.enabled(level)) {                             \
+            maestroLogger_.logf(level, __VA_ARGS__);                     \
+        }                                                                \
+    } while (0)
+
+#define MAESTRO_LOG_DEBUG(...) MAESTRO_LOG(Logger::DEBUG, __VA_ARGS__)
+#define MAESTRO_LOG_INFO(...) MAESTRO_LOG(Logger::INFO, __VA_ARGS__)
+#define MAESTRO_LOG_WARNING(...) MAESTRO_LOG(Logger::WARNING, __VA_ARGS__)
+#define MAESTRO_LOG_ERROR(...) MAESTRO_LOG(Logger::ERROR, __VA_ARGS__)
@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "utils/Trace.h"
+
+namespace metrics {
+
+constexpr size_t kShards = 16;
+constexpr size_t kMaxBuckets = 16;
+
+// Each thread is pinned to one shard so hot-path updates don't contend on a cache line
+size_t shardIndex();
+
+struct alignas(64) CounterShard {
+    std::atomic<uint64_t> value{0};
+};
+
+struct alignas(64) HistogramShard {
+    std::array<std::atomic<uint64_t>, kMaxBuckets + 1> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumMicros{0};
+};
+
+}
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) {
+        shards[metrics::shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    std::array<metrics::CounterShard, metrics::kShards> shards;
+};
+
+// Fixed-bucket histogram; values are in seconds
+class Histogram {
+public:
+    explicit Histogram(const std::vector<double>& bounds);
+    void observe(double value);
+
+    const std::vector<double>& getBounds() const { return bounds; }
+    std::vector<uint64_t> bucketCounts() const;
+    uint64_t count() const;
+    double sum() const;
+
+private:
+    std::vector<double> bounds;
+    std::array<metrics::HistogramShard, metrics::kShards> shards;
+};
+
+// Observes the elapsed time of its scope
+class ScopedLatency {
+public:
+    explicit ScopedLatency(Histogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+class Metrics {
+public:
+    static Metrics& getInstance();
+
+    static const std::vector<double>& latencyBuckets();
+    static const std::vector<double>& slowOperationBuckets();
+
+    // Labels are passed preformatted, e.g. handler="scanNetworks". Returned references stay valid for the
+    // process lifetime, so callers cache them in function-local statics.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+                         const std::vector<double>& bounds = latencyBuckets());
+    void gauge(const std::string& name, const std::string& help, std::function<double()> read);
+
+    std::string renderPrometheus();
+
+private:
+    Metrics() = default;
+
+    struct Family {
+        std::string help;
+        std::string type;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+        std::function<double()> gauge;
+    };
+
+    Family& family(const std::string& name, const std::string& help, const std::string& type);
+
+    std::map<std::string, Family> families;
+    std::mutex familiesMutex;
+};
+
+// Times a controller method into maestro_http_request_duration_seconds{handler="..."} and traces it
+#define MAESTRO_HANDLER_LATENCY(handler)                                                                  \
+    static Histogram& handlerLatency_ = Metrics::getInstance().histogram(                                \
+        "maestro_http_request_duration_seconds", "Request latency per controller method",               \
+        "handler=\"" handler "\"");                                                                      \
+    ScopedLatency handlerLatencyTimer_(handlerLatency_);                                                 \
+    TraceSpan handlerTraceSpan_("http", handler)
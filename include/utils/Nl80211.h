@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct LinkStats;
+struct WiFiScanResult;
+struct nl_sock;
+
+// Direct nl80211 queries over generic netlink, so reading the live link doesn't fork a tool.
+// Only built when libnl-genl-3 is available (MAESTRO_HAVE_LIBNL); otherwise every query fails
+// and callers fall back to `iw` (or, for the scan monitor, do without).
+class Nl80211 {
+public:
+    static Nl80211& getInstance();
+
+    static bool compiledIn();
+
+    // NL80211_CMD_GET_INTERFACE + NL80211_CMD_GET_STATION for the BSS the interface is associated with;
+    // an interface not in station mode (the hotspot) has no link and its stations aren't read
+    bool getLinkStats(const std::string& interface, LinkStats& stats);
+
+    // NL80211_CMD_GET_SCAN dump of the kernel's BSS table for interface, keeping entries seen in the
+    // last maxAgeMs; hidden SSIDs are skipped, as in WiFiUtils::parseScanOutput
+    bool dumpScan(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results);
+
+    // Joins the nl80211 "scan" multicast group on a background thread and calls onResults(interface)
+    // for every NEW_SCAN_RESULTS, whoever started the scan. False when netlink isn't available.
+    bool startScanMonitor(std::function<void(const std::string&)> onResults);
+
+private:
+    Nl80211() = default;
+    ~Nl80211();
+    Nl80211(const Nl80211&) = delete;
+    Nl80211& operator=(const Nl80211&) = delete;
+
+    bool ensureSocket();
+    void closeSocket();
+    void scanMonitorLoop(nl_sock* events);
+
+    // One socket reused across requests; the mutex keeps replies from interleaving
+    std::mutex mutex;
+    nl_sock* sock = nullptr;
+    int familyId = -1;
+
+    std::function<void(const std::string&)> scanHandler;
+    std::atomic<bool> monitoring{false};
+};
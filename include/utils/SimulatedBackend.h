@@ -0,0 +1,109 @@
+#pragma once
+#include "utils/SystemBackend.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Stands in for the radio, wpa_supplicant, hostapd and docker so the portal can be load-tested
+// on a dev box. Radio, wpa_supplicant and hostapd calls are modelled directly; the remaining
+// commands are recognised by the tool and subcommand the real code issues.
+class SimulatedBackend : public SystemBackend {
+public:
+    struct Options {
+        int scanNetworks = 20;
+        int scanLatencyMs = 1500;
+        int associationLatencyMs = 3000;
+        int dhcpLatencyMs = 1000;
+        int serviceLatencyMs = 200;
+        int dockerLatencyMs = 2000;
+        int dockerPullLatencyMs = 10000;
+        double scanFailureRate = 0.0;
+        double connectFailureRate = 0.0;
+        bool apForceSupported = true;
+        int apStations = 0;             // phones associated to the hotspot
+        int apStationInactiveMs = 1000; // how long since each last sent a frame
+        std::string apInterface = "wlan0";
+
+        static Options fromConfig();
+    };
+
+    explicit SimulatedBackend(const Options& options);
+
+    int run(const std::string& command) override;
+    std::string capture(const std::string& command, int* exitStatus) override;
+
+    bool interfaceInfo(const std::string& interface, WirelessInterface& info) override;
+    std::vector<int> phyFrequencies(int wiphy) override;
+    bool addScanInterface(const std::string& parent, const std::string& name, bool& created) override;
+    void removeInterface(const std::string& name) override;
+    bool scan(const std::string& interface, const std::vector<int>& frequencies, bool apForce,
+              std::vector<WiFiScanResult>& results) override;
+    bool linkStats(const std::string& interface, LinkStats& stats) override;
+    // There is no kernel BSS table or scan event stream to harvest
+    bool dumpScanResults(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results) override;
+    bool startScanMonitor(std::function<void(const std::string&)> onResults) override;
+
+    bool wpaStatus(const std::string& interface, std::map<std::string, std::string>& status) override;
+    bool wpaListNetworks(const std::string& interface, std::vector<WpaNetwork>& networks) override;
+    int wpaAddNetwork(const std::string& interface) override;
+    bool wpaSetNetwork(const std::string& interface, int id, const std::string& field, const std::string& value) override;
+    bool wpaGetNetwork(const std::string& interface, int id, const std::string& field, std::string& value) override;
+    bool wpaNetwork(const std::string& interface, WpaNetworkAction action, int id) override;
+    bool wpaDisconnect(const std::string& interface) override;
+    bool wpaReconnect(const std::string& interface) override;
+    bool wpaSaveConfig(const std::string& interface) override;
+
+    // Fails like hostapd while the hotspot is stopped; there are no station events, callers poll
+    bool apStations(std::vector<ApStation>& stations) override;
+    bool startApEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent) override;
+
+private:
+    struct SimulatedBss {
+        std::string bssid;
+        std::string ssid;
+        int frequency;
+        int signalDbm;
+        bool secured;
+    };
+
+    // A wpa_supplicant network block; fields hold values as set_network received them
+    struct SimulatedNetwork {
+        std::map<std::string, std::string> fields;
+        bool disabled = true;
+    };
+
+    int execute(const std::string& command, std::string& output);
+    int dockerCompose(const std::string& command);
+    // Caller holds stateMutex
+    void associate(const SimulatedNetwork& network, bool fails);
+    // Raw SSID from a set_network value: quoted text or hex bytes, as in wpa_supplicant.conf
+    static std::string ssidValue(const std::string& value);
+    bool roll(double failureRate);
+    bool isAssociated();
+    std::string pendingWpaState();
+    void sleepMs(int ms);
+
+    Options options;
+    std::vector<SimulatedBss> environment;
+    std::vector<int> channels;
+
+    std::mutex stateMutex;
+    std::mt19937 random;
+    bool hotspotUp = true;
+    bool imagePulled = false;
+    bool containerCreated = false;
+    bool containerRunning = false;
+    std::set<std::string> scanInterfaces;
+    int nextNetworkId = 0;
+    std::map<int, SimulatedNetwork> networks;
+    bool disconnected = false; // like wpa_supplicant after `disconnect`: enabling a network doesn't connect
+    bool pinnedChannel = false;
+    std::string associatedSsid;
+    bool associationWillSucceed = false;
+    std::chrono::steady_clock::time_point associatedAt;
+    std::chrono::steady_clock::time_point leaseAt;
+};
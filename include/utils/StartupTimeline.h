@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+struct TimelineEvent {
+    std::string phase;
+    double elapsedMs;
+};
+
+// Monotonic timestamps of startup phases, measured from process start
+class StartupTimeline {
+public:
+    static StartupTimeline& getInstance();
+
+    void mark(const std::string& phase);
+    void markOnce(std::atomic<bool>& flag, const std::string& phase);
+    std::vector<TimelineEvent> getEvents();
+
+private:
+    StartupTimeline();
+
+    std::chrono::steady_clock::time_point origin;
+    std::vector<TimelineEvent> events;
+    std::mutex eventsMutex;
+};
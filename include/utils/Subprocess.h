@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+// Single spawn point for external tools so every fork/exec is counted
+class Subprocess {
+public:
+    // Same return value as system()
+    static int run(const std::string& command);
+
+    // Runs through popen() and returns stdout; exitStatus is the tool's exit code, or -1 if it couldn't run
+    static std::string capture(const std::string& command, int* exitStatus = nullptr);
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/HostapdControl.h"
+#include "utils/WiFiUtils.h"
+
+// One network in wpa_supplicant's running configuration
+struct WpaNetwork {
+    int id = -1;
+    std::string ssid; // raw bytes, as the network broadcasts it
+    bool disabled = false;
+};
+
+enum class WpaNetworkAction {
+    Enable,
+    Disable,
+    Select, // enables this one and disables every other network
+    Remove
+};
+
+// A wireless interface as nl80211 describes it
+struct WirelessInterface {
+    int wiphy = -1;
+    std::string type;  // "managed", "AP", ...
+    int frequency = 0; // operating frequency, 0 while the interface isn't on a channel
+};
+
+// Everything the portal does to the system. The radio, wpa_supplicant and hostapd are driven through
+// typed calls, so the simulator implements the operations rather than parsing command lines; generic
+// tools (systemctl, ip, dhclient, nmcli, ping, docker-compose) go through run/capture, which
+// Subprocess forwards to the installed backend.
+class SystemBackend {
+public:
+    virtual ~SystemBackend() = default;
+
+    // Same return value as system()
+    virtual int run(const std::string& command) = 0;
+
+    // Returns stdout; exitStatus is the tool's exit code, or -1 if it couldn't run
+    virtual std::string capture(const std::string& command, int* exitStatus) = 0;
+
+    // Radio; interfaceInfo is false when there is no such interface
+    virtual bool interfaceInfo(const std::string& interface, WirelessInterface& info) = 0;
+    // Enabled channel frequencies (MHz) of a phy
+    virtual std::vector<int> phyFrequencies(int wiphy) = 0;
+    // Brings up a managed interface on parent's phy, adding it first (created) if it doesn't exist yet
+    virtual bool addScanInterface(const std::string& parent, const std::string& name, bool& created) = 0;
+    virtual void removeInterface(const std::string& name) = 0;
+    // Empty frequencies scans every channel; apForce lets a beaconing AP interface scan off-channel
+    virtual bool scan(const std::string& interface, const std::vector<int>& frequencies, bool apForce,
+                      std::vector<WiFiScanResult>& results) = 0;
+    virtual bool linkStats(const std::string& interface, LinkStats& stats) = 0;
+    // The kernel's BSS table, entries seen within maxAgeMs; fails when the table can't be read directly
+    virtual bool dumpScanResults(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results) = 0;
+    // Calls onResults(interface) whenever any scan completes; false when such events aren't available
+    virtual bool startScanMonitor(std::function<void(const std::string&)> onResults) = 0;
+
+    // wpa_supplicant; SSIDs in status and network lists are raw bytes
+    virtual bool wpaStatus(const std::string& interface, std::map<std::string, std::string>& status) = 0;
+    virtual bool wpaListNetworks(const std::string& interface, std::vector<WpaNetwork>& networks) = 0;
+    // New network id, -1 on failure
+    virtual int wpaAddNetwork(const std::string& interface) = 0;
+    // value is in wpa_supplicant.conf syntax: "\"text\"", hex bytes, or a bare token such as any or NONE
+    virtual bool wpaSetNetwork(const std::string& interface, int id, const std::string& field, const std::string& value) = 0;
+    // False when the field isn't set on that network
+    virtual bool wpaGetNetwork(const std::string& interface, int id, const std::string& field, std::string& value) = 0;
+    // A negative id applies Enable and Disable to all networks
+    virtual bool wpaNetwork(const std::string& interface, WpaNetworkAction action, int id) = 0;
+    // After a disconnect the supplicant stays idle, whatever is enabled, until reconnect or Select
+    virtual bool wpaDisconnect(const std::string& interface) = 0;
+    virtual bool wpaReconnect(const std::string& interface) = 0;
+    virtual bool wpaSaveConfig(const std::string& interface) = 0;
+
+    // hostapd
+    virtual bool apStations(std::vector<ApStation>& stations) = 0;
+    // Calls onEvent(event, mac) for AP-STA-CONNECTED / AP-STA-DISCONNECTED; false when unavailable
+    virtual bool startApEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent) = 0;
+
+    static SystemBackend& get();
+
+    // Call before any service starts; selects the backend named by SYSTEM_BACKEND
+    static void installFromConfig();
+    static void install(std::unique_ptr<SystemBackend> backend);
+};
+
+// Real system: fork/exec through the shell, wpa_cli, and hostapd's and nl80211's sockets where available
+class ShellBackend : public SystemBackend {
+public:
+    int run(const std::string& command) override;
+    std::string capture(const std::string& command, int* exitStatus) override;
+
+    bool interfaceInfo(const std::string& interface, WirelessInterface& info) override;
+    std::vector<int> phyFrequencies(int wiphy) override;
+    bool addScanInterface(const std::string& parent, const std::string& name, bool& created) override;
+    void removeInterface(const std::string& name) override;
+    bool scan(const std::string& interface, const std::vector<int>& frequencies, bool apForce,
+              std::vector<WiFiScanResult>& results) override;
+    bool linkStats(const std::string& interface, LinkStats& stats) override;
+    bool dumpScanResults(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results) override;
+    bool startScanMonitor(std::function<void(const std::string&)> onResults) override;
+
+    bool wpaStatus(const std::string& interface, std::map<std::string, std::string>& status) override;
+    bool wpaListNetworks(const std::string& interface, std::vector<WpaNetwork>& networks) override;
+    int wpaAddNetwork(const std::string& interface) override;
+    bool wpaSetNetwork(const std::string& interface, int id, const std::string& field, const std::string& value) override;
+    bool wpaGetNetwork(const std::string& interface, int id, const std::string& field, std::string& value) override;
+    bool wpaNetwork(const std::string& interface, WpaNetworkAction action, int id) override;
+    bool wpaDisconnect(const std::string& interface) override;
+    bool wpaReconnect(const std::string& interface) override;
+    bool wpaSaveConfig(const std::string& interface) override;
+
+    bool apStations(std::vector<ApStation>& stations) override;
+    bool startApEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent) override;
+
+    // list_networks output: "id<TAB>ssid<TAB>bssid<TAB>flags" rows after a header line, ssid escaped
+    static std::vector<WpaNetwork> parseListNetworks(const std::string& output);
+
+private:
+    // `wpa_cli -i <interface> <arguments>`; false on a non-zero exit or a FAIL reply
+    bool wpaCli(const std::string& interface, const std::string& arguments, std::string* output = nullptr);
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// The two pieces of the systemd protocol the portal needs (socket activation and readiness
+// notification), implemented directly so there is no libsystemd dependency.
+class Systemd {
+public:
+    // Sockets passed by a .socket unit (LISTEN_FDS, starting at fd 3), empty when not socket-activated.
+    // Clears the LISTEN_* variables so child processes don't think they were activated too.
+    static std::vector<int> listenFds();
+
+    // Sends a state such as "READY=1" or "STOPPING=1" to $NOTIFY_SOCKET; false when not under systemd
+    static bool notify(const std::string& state);
+
+    // Local TCP port a socket is bound to, or 0
+    static int boundPort(int fd);
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One finished span ("ph":"X" complete event); category and name point at string literals
+struct TraceEvent {
+    const char* category;
+    const char* name;
+    int64_t startUs;
+    int64_t durationUs;
+    std::string detail;
+};
+
+// Span recorder exported as Chrome / Perfetto trace-event JSON. Each thread writes into its own
+// fixed-size ring (TRACE_BUFFER_EVENTS), so recording never contends with other threads. A ring is
+// only allocated once a thread records a span, and goes back to a pool for the next new thread when
+// its thread exits, so short-lived threads don't add memory.
+class Trace {
+public:
+    static Trace& getInstance();
+
+    static bool enabled() { return enabledFlag.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    static int64_t nowUs();
+    void record(const char* category, const char* name, int64_t startUs, int64_t durationUs,
+                std::string detail = std::string());
+
+    // Label for the calling thread in trace viewers; cheap whether or not tracing is enabled
+    void setThreadName(const std::string& name);
+
+    std::string renderJson();
+    void clear();
+
+private:
+    Trace();
+
+    struct ThreadBuffer {
+        int tid = 0;
+        std::string name;
+        std::vector<TraceEvent> events;
+        size_t next = 0;
+        bool wrapped = false;
+        std::mutex mutex;
+    };
+
+    // Thread-local handle that returns the thread's ring to the pool when the thread exits
+    struct BufferOwner {
+        ThreadBuffer* buffer = nullptr;
+        ~BufferOwner();
+    };
+
+    ThreadBuffer& threadBuffer();
+    void releaseBuffer(ThreadBuffer* buffer);
+
+    static thread_local BufferOwner threadOwner;
+
+    static std::atomic<bool> enabledFlag;
+    size_t capacity;
+    std::vector<ThreadBuffer*> buffers;     // every ring, including those of exited threads
+    std::vector<ThreadBuffer*> freeBuffers; // rings of exited threads, kept for dumps until reused
+    int nextTid = 1;
+    std::mutex buffersMutex;
+};
+
+// Records the enclosing scope as one span when tracing is enabled
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name, std::string detail = std::string())
+        : category(category), name(name), active(Trace::enabled()) {
+        if (active) {
+            this->detail = std::move(detail);
+            start = Trace::nowUs();
+        }
+    }
+    ~TraceSpan() {
+        if (active) {
+            Trace::getInstance().record(category, name, start, Trace::nowUs() - start, std::move(detail));
+        }
+    }
+
+private:
+    const char* category;
+    const char* name;
+    bool active;
+    int64_t start = 0;
+    std::string detail;
+};
+
+#define MAESTRO_TRACE_CONCAT_(a, b) a##b
+#define MAESTRO_TRACE_CONCAT(a, b) MAESTRO_TRACE_CONCAT_(a, b)
+#define MAESTRO_TRACE_SPAN(category, name) TraceSpan MAESTRO_TRACE_CONCAT(traceSpan_, __LINE__)(category, name)
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// One file from web/, compiled in by cmake/EmbedWebAssets.cmake
+struct EmbeddedAsset {
+    const char* path;           // relative to web/, e.g. "static/js/app.js"
+    const char* url;            // content-hashed URL for static files, e.g. "/static/js/app.d5e74d339338.js"
+    const char* contentType;
+    const char* etag;           // of the identity body; compressed variants add -gz / -br inside the quotes
+    const unsigned char* data;
+    size_t size;
+    const unsigned char* gzipData;      // nullptr when compression didn't make it smaller
+    size_t gzipSize;
+    const unsigned char* brotliData;
+    size_t brotliSize;
+};
+
+class WebAssets {
+public:
+    // False when built with MAESTRO_EMBED_WEB=OFF; everything is then read from the web/ document root
+    static bool available();
+
+    // Matches the hashed URL (immutable is set) or the original one, so old pages keep working
+    static const EmbeddedAsset* findByUrl(const std::string& url, bool& immutable);
+    static const EmbeddedAsset* findByPath(const std::string& path);
+};
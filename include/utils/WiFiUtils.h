@@ -1,21 +1,81 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <set>
+#include <cstdint>
 
 struct WiFiScanResult {
-    std::string ssid;
+    std::string ssid; // raw bytes, whichever way the scan was read
     int signal_strength;
     std::string security;
+    std::string bssid;
+    int frequency = 0;
+};
+
+// Live link of the client interface, from nl80211 station info (or `iw` when netlink isn't available)
+struct LinkStats {
+    bool associated = false;
+    bool authorized = false; // the AP has authorized us, i.e. the 4-way handshake finished
+    std::string ssid;
+    std::string bssid;
+    int frequency = 0;
+    int signalDbm = 0;
+    int signalAvgDbm = 0; // 0 when the driver doesn't average
+    double txBitrateMbps = 0;
+    double rxBitrateMbps = 0;
+    uint32_t txRetries = 0;
+    uint32_t txFailed = 0;
 };
 
 class WiFiUtils {
 public:
     static std::vector<WiFiScanResult> scanNetworks(bool full_scan = false);
-    static bool connectToNetwork(const std::string& ssid, const std::string& password);
+    // psk is the 64-hex-digit key from derivePsk, or empty for an open network
+    static bool connectToNetwork(const std::string& ssid, const std::string& psk);
     static bool isConnected();
     static std::string getCurrentSSID();
+
+    // wpa_supplicant's wpa_state (ASSOCIATING, 4WAY_HANDSHAKE, COMPLETED, ...), empty if unavailable
+    static std::string getWpaState();
+    // "a.b.c.d/len" once DHCP has configured the interface, otherwise empty
+    static std::string getIpv4Address();
+
+    // Signal, bitrates, retries and channel of the current association; associated is false when there is none
+    static LinkStats getLinkStats();
+
+    // Re-selects a network wpa_supplicant already knows, pinned to one BSS and channel so the
+    // association skips the full channel sweep. Waits at most timeoutMs for wpa_state=COMPLETED.
+    static bool reconnectKnownNetwork(const std::string& ssid, const std::string& bssid, int frequency, int timeoutMs);
+
+    // WPA2-Personal key: PBKDF2-HMAC-SHA1(passphrase, ssid, 4096 rounds, 256 bits) as hex, which is
+    // what wpa_supplicant would otherwise compute itself. A 64-hex-digit passphrase is already a key
+    // and is returned as is; an invalid passphrase yields an empty string.
+    static std::string derivePsk(const std::string& ssid, const std::string& passphrase);
+
+    // Parses `iw dev <if> scan` output into one result per BSS, with SSIDs unescaped to raw bytes
+    static std::vector<WiFiScanResult> parseScanOutput(const std::string& output);
+
+    // Parses `iw dev <if> link` followed by `iw dev <if> station dump`
+    static LinkStats parseLinkOutput(const std::string& output);
+
+    // Raw SSID bytes from the escaped text wpa_cli and iw print: \xNN, plus \\, \", \e, \n, \r, \t
+    static std::string unescapeSsid(const std::string& text);
+
+    // Loads the scan cache written by the scan helper service
+    static std::vector<WiFiScanResult> scanFromCache(const std::string& path = "/var/cache/maestro/wifi-scan.json");
+
+    // Longest continuous hostapd outage (ms) of the most recent full scan
+    static long getLastMaxApOutageMs();
 private:
-    static std::vector<WiFiScanResult> scanFromCache();
     static std::vector<WiFiScanResult> scanWithVirtualInterface();
-    static std::vector<WiFiScanResult> fullScanWithInterruption();
+    // Both raise maxOutageMs to the longest hostapd outage they caused
+    static std::vector<WiFiScanResult> fullScanWithInterruption(long& maxOutageMs);
+    // Frequencies in coveredElsewhere are being swept by a secondary radio and are skipped here
+    static std::vector<WiFiScanResult> chunkedFullScan(long& maxOutageMs,
+                                                       const std::set<int>& coveredElsewhere = std::set<int>());
+    static std::vector<std::string> getSecondaryInterfaces();
+    static std::vector<WiFiScanResult> scanFrequencies(const std::string& interface, const std::vector<int>& frequencies,
+                                                       bool apForce, bool& ok);
+    static std::vector<int> getSupportedFrequencies(const std::string& interface);
+    static int getOperatingFrequency(const std::string& interface);
 };
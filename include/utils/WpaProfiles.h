@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Index of wpa_supplicant's configured networks by SSID, loaded once with list_networks. Connects
+// reuse an SSID's existing profile when the key is unchanged; a new key is tried in a staged profile
+// that replaces the old one only once it has connected, so a wrong password never overwrites a
+// working one. Duplicates are removed, and wpa_supplicant.conf is only rewritten (save_config)
+// after a successful connect that actually changed something.
+class WpaProfiles {
+public:
+    static WpaProfiles& getInstance();
+
+    // Network id holding ssid with this key (empty for an open network): the existing profile if the
+    // key matches, otherwise a staged one with the SSID's current profile disabled meanwhile; -1 if
+    // wpa_supplicant didn't take it
+    int configure(const std::string& ssid, const std::string& psk);
+    // Id of the profile for ssid, -1 if there is none
+    int find(const std::string& ssid);
+
+    // Ends the connect attempt configure() started. Success swaps the staged profile in, saves the
+    // config if anything changed and trims to the WPA_MAX_PROFILES most recently used; failure drops
+    // the staged profile and re-enables the one it would have replaced.
+    void finishAttempt(const std::string& ssid, bool success);
+
+    // Forget the index; the next call reloads it from wpa_supplicant
+    void invalidate();
+
+private:
+    WpaProfiles();
+    WpaProfiles(const WpaProfiles&) = delete;
+    WpaProfiles& operator=(const WpaProfiles&) = delete;
+
+    struct Profile {
+        int id = -1;            // -1 while the first attempt for a new SSID is in progress
+        std::string keyDigest;  // SHA-256 of the key last saved from here (WPA_KEY_DIGEST_FILE); empty when unknown
+        uint64_t lastConnected = 0; // connect sequence number; 0 for profiles not used since startup
+        int staged = -1;        // profile holding the key being tried, until the attempt ends
+        std::string stagedDigest;
+    };
+
+    bool load();
+    void loadDigests();
+    // Records the digests of the saved profiles; call right after save_config
+    void saveDigests();
+    void removeProfile(int id);
+    // Removes the staged profile and re-enables the one it was to replace; false when nothing is left
+    bool discardStaged(Profile& profile);
+
+    std::string interface;
+    std::string digestPath;
+    size_t maxProfiles;
+
+    std::mutex mutex;
+    bool loaded = false;
+    bool unsaved = false; // the running config differs from wpa_supplicant.conf
+    uint64_t connects = 0;
+    std::map<std::string, Profile> profiles;
+};
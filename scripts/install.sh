@@ -95,9 +95,27 @@ nmcli connection add type wifi ifname wlan0 con-name maestro-hotspot autoconnect
     ipv4.method shared \
     ipv4.address 192.168.4.1/24
 
+# Listening socket held by systemd, so connections made during a restart wait instead of being refused.
+# The service only Wants it: without the socket the portal binds SERVER_PORT itself.
+echo "Creating systemd listener socket..."
+PORT=$(sed -n 's/^SERVER_PORT=\([0-9]*\).*/\1/p' /opt/maestro/captive/config/maestro.conf 2>/dev/null | tail -n 1)
+cat > /etc/systemd/system/maestro-captive.socket << SOCKETEOF
+[Unit]
+Description=Maestro Captive Portal Listener
+
+[Socket]
+ListenStream=0.0.0.0:${PORT:-8080}
+ReusePort=yes
+Backlog=1024
+
+[Install]
+WantedBy=sockets.target
+SOCKETEOF
+
 # Enable and configure systemd services
 echo "Configuring systemd services..."
 systemctl daemon-reload
+systemctl enable maestro-captive.socket
 systemctl enable maestro-captive.service
 systemctl enable maestro-hotspot.service  
 systemctl enable maestro-dhcp.service
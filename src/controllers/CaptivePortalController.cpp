@@ -1,8 +1,80 @@
 #include "controllers/CaptivePortalController.h"
+#include "utils/CaptiveSessions.h"
+#include "utils/HttpHeaders.h"
+#include "utils/Metrics.h"
+#include "utils/WebAssets.h"
 #include <fstream>
 #include <sstream>
 
+namespace {
+
+Counter& probeCounter(const std::string& probe) {
+    return Metrics::getInstance().counter("maestro_captive_probes_total", "Captive portal detection probes by OS",
+                                          "probe=\"" + probe + "\"");
+}
+
+Counter& answerCounter(const std::string& answer) {
+    return Metrics::getInstance().counter("maestro_captive_probe_answers_total",
+                                          "Captive probe replies: portal redirect or the real online response",
+                                          "answer=\"" + answer + "\"");
+}
+
+// One stored encoding of an embedded asset
+struct AssetVariant {
+    const unsigned char* data;
+    size_t size;
+    const char* encoding; // nullptr for identity
+    const char* etagSuffix;
+};
+
+// Picks the smallest variant the client accepts; the arrays are copied straight into the body
+AssetVariant pickVariant(const EmbeddedAsset& asset, const std::string& acceptEncoding) {
+    if (asset.brotliData && HttpHeaders::acceptsEncoding(acceptEncoding, "br")) {
+        return {asset.brotliData, asset.brotliSize, "br", "-br"};
+    }
+    if (asset.gzipData && HttpHeaders::acceptsEncoding(acceptEncoding, "gzip")) {
+        return {asset.gzipData, asset.gzipSize, "gzip", "-gz"};
+    }
+    return {asset.data, asset.size, nullptr, ""};
+}
+
+// Each encoding is different bytes, so each gets its own strong tag: "<hash>-br" next to "<hash>"
+std::string variantEtag(const EmbeddedAsset& asset, const AssetVariant& variant) {
+    std::string etag = asset.etag;
+    return etag.substr(0, etag.size() - 1) + variant.etagSuffix + "\"";
+}
+
+void setEmbeddedBody(const HttpResponsePtr& resp, const EmbeddedAsset& asset, const AssetVariant& variant) {
+    if (variant.encoding) resp->addHeader("Content-Encoding", variant.encoding);
+    resp->addHeader("Vary", "Accept-Encoding");
+    resp->setContentTypeCodeAndCustomString(CT_CUSTOM, asset.contentType);
+    resp->setBody(std::string(reinterpret_cast<const char*>(variant.data), variant.size));
+}
+
+}
+
+uint64_t CaptivePortalController::clientKey(const HttpRequestPtr& req, std::string& address) {
+    const auto& peer = req->peerAddr();
+    address = peer.toIp();
+    return CaptiveSessions::keyFor(address, peer.ipNetEndian(), peer.isIpV6());
+}
+
 void CaptivePortalController::index(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("CaptivePortalController::index");
+
+    std::string address;
+    CaptiveSessions::getInstance().recordPortalView(clientKey(req, address), address);
+
+    if (const EmbeddedAsset* page = WebAssets::findByPath("templates/index.html")) {
+        auto resp = HttpResponse::newHttpResponse();
+        setEmbeddedBody(resp, *page, pickVariant(*page, req->getHeader("Accept-Encoding")));
+        resp->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+        resp->addHeader("Pragma", "no-cache");
+        resp->addHeader("Expires", "0");
+        callback(resp);
+        return;
+    }
+
     std::ifstream file("web/templates/index.html");
     if (!file.is_open()) {
         auto resp = HttpResponse::newHttpResponse();
@@ -28,65 +100,92 @@ void CaptivePortalController::index(const HttpRequestPtr& req, std::function<voi
     callback(resp);
 }
 
+HttpResponsePtr CaptivePortalController::serveEmbeddedAsset(const HttpRequestPtr& req) {
+    if (req->method() != Get && req->method() != Head) return nullptr;
+
+    bool immutable = false;
+    const EmbeddedAsset* asset = WebAssets::findByUrl(req->path(), immutable);
+    if (!asset) return nullptr;
+
+    AssetVariant variant = pickVariant(*asset, req->getHeader("Accept-Encoding"));
+    std::string etag = variantEtag(*asset, variant);
+    auto resp = HttpResponse::newHttpResponse();
+    if (HttpHeaders::etagMatches(req->getHeader("If-None-Match"), etag)) {
+        // Revalidation of an unchanged asset, typically index.html after max-age ran out
+        resp->setStatusCode(k304NotModified);
+        resp->addHeader("Vary", "Accept-Encoding");
+    } else {
+        setEmbeddedBody(resp, *asset, variant);
+    }
+    resp->addHeader("ETag", etag);
+    // Hashed URLs change whenever the content does, so they can be cached forever
+    resp->addHeader("Cache-Control", immutable ? "public, max-age=31536000, immutable" : "public, max-age=86400");
+    return resp;
+}
+
 void CaptivePortalController::captiveDetect(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("CaptivePortalController::captiveDetect");
+
     // Handle captive portal detection requests from various devices
     std::string userAgent = req->getHeader("User-Agent");
     std::string requestUri = req->getPath();
-    
-    // Log the detection attempt
-    LOG_INFO << "Captive portal detection from: " << userAgent << " requesting: " << requestUri;
-    
-    // Different devices expect different responses for captive portal detection
-    
-    // Firefox expects a specific response
-    if (requestUri.find("success.txt") != std::string::npos) {
-        auto resp = HttpResponse::newHttpResponse();
-        resp->setStatusCode(k200OK);
-        resp->setContentTypeCode(CT_TEXT_PLAIN);
-        resp->setBody("success");
-        callback(resp);
-        return;
-    }
-    
-    // Microsoft connectivity test
-    if (requestUri.find("ncsi.txt") != std::string::npos || 
-        requestUri.find("connecttest.txt") != std::string::npos) {
-        auto resp = HttpResponse::newHttpResponse();
-        resp->setStatusCode(k200OK);
-        resp->setContentTypeCode(CT_TEXT_PLAIN);
-        resp->setBody("Microsoft NCSI");
-        callback(resp);
-        return;
-    }
-    
-    // Android/Google connectivity check
-    if (requestUri.find("generate_204") != std::string::npos) {
-        // Instead of 204, redirect to our portal to trigger captive portal detection
+
+    static Counter& firefoxProbes = probeCounter("firefox");
+    static Counter& microsoftProbes = probeCounter("microsoft");
+    static Counter& androidProbes = probeCounter("android");
+    static Counter& appleProbes = probeCounter("apple");
+    static Counter& ubuntuProbes = probeCounter("ubuntu");
+    static Counter& otherProbes = probeCounter("other");
+
+    bool firefox = requestUri.find("success.txt") != std::string::npos;
+    bool ncsi = requestUri.find("ncsi.txt") != std::string::npos;
+    bool connectTest = requestUri.find("connecttest.txt") != std::string::npos;
+    bool apple = requestUri.find("hotspot-detect.html") != std::string::npos;
+    if (firefox) firefoxProbes.inc();
+    else if (ncsi || connectTest) microsoftProbes.inc();
+    else if (apple) appleProbes.inc();
+    else if (requestUri.find("generate_204") != std::string::npos) androidProbes.inc();
+    else if (requestUri.find("connectivity-check") != std::string::npos) ubuntuProbes.inc();
+    else otherProbes.inc();
+
+    std::string address;
+    uint64_t key = clientKey(req, address);
+    CaptiveState state = CaptiveSessions::getInstance().recordProbe(key, address);
+
+    LOG_DEBUG << "Captive portal detection from " << address << " (" << userAgent << ") requesting: " << requestUri;
+
+    // Until this client has finished setup every OS gets the same captive answer, so its
+    // sign-in prompt stays up; afterwards it gets the real "online" reply and stops re-probing
+    if (state != CaptiveState::Complete) {
+        static Counter& portalAnswers = answerCounter("portal");
+        portalAnswers.inc();
         auto resp = HttpResponse::newRedirectionResponse("http://192.168.4.1/");
         resp->setStatusCode(k302Found);
+        resp->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
         callback(resp);
         return;
     }
-    
-    // Apple captive portal detection
-    if (requestUri.find("hotspot-detect.html") != std::string::npos) {
-        auto resp = HttpResponse::newHttpResponse();
-        resp->setStatusCode(k200OK);
+
+    static Counter& successAnswers = answerCounter("success");
+    successAnswers.inc();
+
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k200OK);
+    if (firefox) {
+        resp->setContentTypeCode(CT_TEXT_PLAIN);
+        resp->setBody("success\n");
+    } else if (ncsi) {
+        resp->setContentTypeCode(CT_TEXT_PLAIN);
+        resp->setBody("Microsoft NCSI");
+    } else if (connectTest) {
+        resp->setContentTypeCode(CT_TEXT_PLAIN);
+        resp->setBody("Microsoft Connect Test");
+    } else if (apple) {
         resp->setContentTypeCode(CT_TEXT_HTML);
         resp->setBody("<HTML><HEAD><TITLE>Success</TITLE></HEAD><BODY>Success</BODY></HTML>");
-        callback(resp);
-        return;
+    } else {
+        // Android and NetworkManager (Ubuntu) treat an empty 204 as online
+        resp->setStatusCode(k204NoContent);
     }
-    
-    // Ubuntu connectivity check
-    if (requestUri.find("connectivity-check") != std::string::npos) {
-        auto resp = HttpResponse::newRedirectionResponse("http://192.168.4.1/");
-        callback(resp);
-        return;
-    }
-    
-    // Default: redirect any other request to our main portal
-    auto resp = HttpResponse::newRedirectionResponse("http://192.168.4.1/");
-    resp->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     callback(resp);
 }
@@ -0,0 +1,126 @@
+#include "controllers/DiagnosticsController.h"
+#include "controllers/JsonResponse.h"
+#include "services/WiFiManagerService.h"
+#include "utils/CaptiveSessions.h"
+#include "utils/Metrics.h"
+#include "utils/StartupTimeline.h"
+#include "utils/Trace.h"
+#include <chrono>
+
+void DiagnosticsController::getStartupTimeline(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("DiagnosticsController::getStartupTimeline");
+
+    JsonWriter json;
+    json.beginObject().field("status", "success").key("phases").beginArray();
+    for (const auto& event : StartupTimeline::getInstance().getEvents()) {
+        json.beginObject().field("phase", event.phase).field("elapsed_ms", event.elapsedMs).endObject();
+    }
+    json.endArray().endObject();
+
+    callback(jsonResponse(json));
+}
+
+void DiagnosticsController::getConnectAttempts(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("DiagnosticsController::getConnectAttempts");
+
+    JsonWriter json;
+    json.beginObject().field("status", "success").key("attempts").beginArray();
+    for (const auto& attempt : WiFiManagerService::getInstance().getRecentConnectAttempts()) {
+        json.beginObject()
+            .field("id", attempt.id)
+            .field("ssid", attempt.ssid)
+            .field("started_at_ms", attempt.startedAtEpochMs)
+            .field("total_ms", attempt.totalMs)
+            .field("success", attempt.success);
+        if (!attempt.success) {
+            json.field("failed_phase", attempt.failedPhase);
+        }
+        json.key("phases").beginArray();
+        for (const auto& phase : attempt.phases) {
+            json.beginObject()
+                .field("phase", phase.name)
+                .field("start_ms", phase.startMs)
+                .field("duration_ms", phase.durationMs)
+                .field("ok", phase.ok);
+            if (!phase.detail.empty()) {
+                json.field("detail", phase.detail);
+            }
+            json.endObject();
+        }
+        json.endArray().endObject();
+    }
+    json.endArray().endObject();
+
+    callback(jsonResponse(json));
+}
+
+void DiagnosticsController::getCaptiveSessions(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("DiagnosticsController::getCaptiveSessions");
+
+    static const char* stateNames[] = {"probing", "portal_viewed", "complete"};
+    auto& sessions = CaptiveSessions::getInstance();
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    JsonWriter json;
+    json.beginObject()
+        .field("status", "success")
+        .field("capacity", sessions.capacity())
+        .key("clients").beginArray();
+    for (const auto& session : sessions.snapshot()) {
+        json.beginObject().field("address", session.address);
+        if (!session.mac.empty()) {
+            json.field("mac", session.mac);
+        }
+        json.field("state", stateNames[static_cast<int>(session.state)])
+            .field("probes", session.probes)
+            .field("portal_views", session.portalViews)
+            .field("first_seen_ms_ago", nowMs - session.firstSeenMs)
+            .field("last_seen_ms_ago", nowMs - session.lastSeenMs)
+            .endObject();
+    }
+    json.endArray().endObject();
+
+    callback(jsonResponse(json));
+}
+
+void DiagnosticsController::getTrace(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    // Chrome trace-event JSON, loadable in chrome://tracing or ui.perfetto.dev
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k200OK);
+    resp->setContentTypeCode(CT_APPLICATION_JSON);
+    resp->addHeader("Content-Disposition", "attachment; filename=\"maestro-trace.json\"");
+    resp->setBody(Trace::getInstance().renderJson());
+    callback(resp);
+}
+
+void DiagnosticsController::updateTrace(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto jsonBody = req->getJsonObject();
+    bool hasEnable = jsonBody && (*jsonBody)["enable"].isBool();
+    bool hasClear = jsonBody && (*jsonBody)["clear"].isBool();
+    if (!hasEnable && !hasClear) {
+        JsonWriter json;
+        json.beginObject().field("status", "error").field("message", "Expected {\"enable\": bool} and/or {\"clear\": bool}").endObject();
+        callback(jsonResponse(json, k400BadRequest));
+        return;
+    }
+
+    auto& trace = Trace::getInstance();
+    if (hasEnable) trace.setEnabled((*jsonBody)["enable"].asBool());
+    if (hasClear && (*jsonBody)["clear"].asBool()) trace.clear();
+
+    JsonWriter json;
+    json.beginObject().field("status", "success").field("enabled", Trace::enabled()).endObject();
+    callback(jsonResponse(json));
+}
+
+void DiagnosticsController::getMetrics(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("DiagnosticsController::getMetrics");
+
+    // Prometheus text exposition format
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k200OK);
+    resp->setContentTypeCode(CT_TEXT_PLAIN);
+    resp->setBody(Metrics::getInstance().renderPrometheus());
+    callback(resp);
+}
@@ -1,79 +1,142 @@
 #include "controllers/ServiceController.h"
+#include "controllers/BlockingHandler.h"
+#include "controllers/JsonResponse.h"
 #include "services/HomeAssistantService.h"
+#include "services/HardwareSecurityService.h"
+#include "utils/CaptiveSessions.h"
 #include "utils/ConfigManager.h"
-#include <json/json.h>
+#include "utils/Subprocess.h"
+#include "utils/Metrics.h"
 #include <cstdlib>
 
 void ServiceController::startHomeAssistant(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& haService = HomeAssistantService::getInstance();
-    bool success = haService.start();
-    
-    Json::Value response;
-    response["status"] = success ? "success" : "error";
-    response["message"] = success ? "Home Assistant started" : "Failed to start Home Assistant";
-    
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+    runBlocking("service", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("ServiceController::startHomeAssistant");
+
+        auto& haService = HomeAssistantService::getInstance();
+        HomeAssistantStart result = haService.start();
+
+        JsonWriter json;
+        if (result == HomeAssistantStart::Pending) {
+            // Still pulling or creating; the client polls /api/services/status until it runs
+            auto prepare = haService.getPrepareStatus();
+            json.beginObject()
+                .field("status", "accepted")
+                .field("message", "Home Assistant is being prepared and will start when ready")
+                .key("homeassistant_prepare").beginObject()
+                .field("state", prepare.state)
+                .field("elapsed_ms", prepare.elapsedMs)
+                .endObject()
+                .endObject();
+            return jsonResponse(json, k202Accepted);
+        }
+
+        bool success = result == HomeAssistantStart::Started;
+        json.beginObject()
+            .field("status", success ? "success" : "error")
+            .field("message", success ? "Home Assistant started" : "Failed to start Home Assistant")
+            .endObject();
+        return jsonResponse(json);
+    });
 }
 
 void ServiceController::stopHomeAssistant(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& haService = HomeAssistantService::getInstance();
-    bool success = haService.stop();
-    
-    Json::Value response;
-    response["status"] = success ? "success" : "error";
-    response["message"] = success ? "Home Assistant stopped" : "Failed to stop Home Assistant";
+    runBlocking("service", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("ServiceController::stopHomeAssistant");
+
+        auto& haService = HomeAssistantService::getInstance();
+        bool success = haService.stop();
     
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+        JsonWriter json;
+        json.beginObject()
+            .field("status", success ? "success" : "error")
+            .field("message", success ? "Home Assistant stopped" : "Failed to stop Home Assistant")
+            .endObject();
+        return jsonResponse(json);
+    });
 }
 
 void ServiceController::getServiceStatus(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& haService = HomeAssistantService::getInstance();
-    
-    Json::Value response;
-    response["status"] = "success";
-    response["homeassistant"] = haService.isRunning();
-    
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+    runBlocking("status", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("ServiceController::getServiceStatus");
+
+        auto& haService = HomeAssistantService::getInstance();
+
+        JsonWriter json;
+        json.beginObject()
+            .field("status", "success")
+            .field("homeassistant", haService.isRunning());
+
+        auto prepare = haService.getPrepareStatus();
+        json.key("homeassistant_prepare").beginObject().field("state", prepare.state);
+        if (!prepare.trigger.empty()) {
+            json.field("trigger", prepare.trigger).field("elapsed_ms", prepare.elapsedMs);
+        }
+        if (!prepare.detail.empty()) {
+            json.field("detail", prepare.detail);
+        }
+        if (prepare.startPending) {
+            json.field("start_pending", true);
+        }
+        json.endObject();
+
+        // In-memory verdict; never waits on the license server
+        auto& security = HardwareSecurityService::getInstance();
+        json.key("license").beginObject().field("valid", security.validateLicense());
+        auto verdict = security.getVerdict();
+        if (verdict.expiresAt != 0) {
+            json.field("expires", verdict.expiresAt);
+        }
+        json.endObject().endObject();
+
+        return jsonResponse(json);
+    });
 }
 
 void ServiceController::shutdownHotspot(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    Json::Value response;
-
-    try {
-        auto& config = ConfigManager::getInstance();
-        std::string hotspotService = config.get("HOTSPOT_SERVICE_NAME", "maestro-hotspot.service");
-        std::string dhcpService = config.get("DHCP_SERVICE_NAME", "maestro-dhcp.service");
-
-        // Stop the hotspot connection
-        std::string stopHotspotCmd = "systemctl stop " + hotspotService;
-        int hotspotResult = system(stopHotspotCmd.c_str());
-
-        // Stop the DHCP/DNS service
-        std::string stopDhcpCmd = "systemctl stop " + dhcpService;
-        int dhcpResult = system(stopDhcpCmd.c_str());
-
-        // Disable services to prevent auto-restart
-        std::string disableHotspotCmd = "systemctl disable " + hotspotService;
-        std::string disableDhcpCmd = "systemctl disable " + dhcpService;
-        system(disableHotspotCmd.c_str());
-        system(disableDhcpCmd.c_str());
-
-        if (hotspotResult == 0 && dhcpResult == 0) {
-            response["status"] = "success";
-            response["message"] = "Hotspot and DHCP services shutdown successfully";
-        } else {
-            response["status"] = "warning";
-            response["message"] = "Some services may not have stopped cleanly";
-        }
+    runBlocking("service", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("ServiceController::shutdownHotspot");
+
+        const char* status;
+        std::string message;
 
-    } catch (const std::exception& e) {
-        response["status"] = "error";
-        response["message"] = std::string("Failed to shutdown services: ") + e.what();
-    }
+        try {
+            auto& config = ConfigManager::getInstance();
+            std::string hotspotService = config.get("HOTSPOT_SERVICE_NAME", "maestro-hotspot.service");
+            std::string dhcpService = config.get("DHCP_SERVICE_NAME", "maestro-dhcp.service");
+
+            // Stop the hotspot connection
+            std::string stopHotspotCmd = "systemctl stop " + hotspotService;
+            int hotspotResult = Subprocess::run(stopHotspotCmd);
+
+            // Stop the DHCP/DNS service
+            std::string stopDhcpCmd = "systemctl stop " + dhcpService;
+            int dhcpResult = Subprocess::run(stopDhcpCmd);
+
+            // Disable services to prevent auto-restart
+            std::string disableHotspotCmd = "systemctl disable " + hotspotService;
+            std::string disableDhcpCmd = "systemctl disable " + dhcpService;
+            Subprocess::run(disableHotspotCmd);
+            Subprocess::run(disableDhcpCmd);
+
+            // Setup is over: any client still probing is told it is online
+            CaptiveSessions::getInstance().markAllComplete();
+
+            if (hotspotResult == 0 && dhcpResult == 0) {
+                status = "success";
+                message = "Hotspot and DHCP services shutdown successfully";
+            } else {
+                status = "warning";
+                message = "Some services may not have stopped cleanly";
+            }
+
+        } catch (const std::exception& e) {
+            status = "error";
+            message = std::string("Failed to shutdown services: ") + e.what();
+        }
 
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+        JsonWriter json;
+        json.beginObject().field("status", status).field("message", message).endObject();
+        return jsonResponse(json);
+    });
 }
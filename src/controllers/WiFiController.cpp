@@ -1,8 +1,129 @@
 #include "controllers/WiFiController.h"
+#include "controllers/BlockingHandler.h"
+#include "controllers/JsonResponse.h"
 #include "services/WiFiManagerService.h"
+#include "services/HomeAssistantService.h"
+#include "services/ScanScheduler.h"
+#include "controllers/CaptivePortalController.h"
+#include "utils/CaptiveSessions.h"
 #include "utils/ConfigManager.h"
+#include "utils/HttpHeaders.h"
 #include "utils/Logger.h"
-#include <json/json.h>
+#include "utils/WiFiUtils.h"
+#include "utils/Subprocess.h"
+#include "utils/Metrics.h"
+#include <mutex>
+#include <random>
+#include <cstdio>
+
+namespace {
+
+// Serialized body of the last cached-scan response, reused until the scan cache version moves
+struct SerializedScan {
+    uint64_t version = 0;
+    bool valid = false;
+    std::string etag;
+    std::string body;
+};
+
+std::mutex serializedScanMutex;
+SerializedScan serializedScan;
+
+// Distinguishes versions across restarts, which start counting from zero again
+const std::string& bootNonce() {
+    static const std::string nonce = [] {
+        std::random_device random;
+        char buffer[17];
+        snprintf(buffer, sizeof(buffer), "%08x%08x", random(), random());
+        return std::string(buffer);
+    }();
+    return nonce;
+}
+
+// Cache versions restart at zero on every boot, so clients see them prefixed with the boot nonce
+std::string versionToken(uint64_t version) {
+    return bootNonce() + "-" + std::to_string(version);
+}
+
+bool parseVersionToken(const std::string& token, uint64_t& version) {
+    const std::string& nonce = bootNonce();
+    if (token.size() <= nonce.size() + 1 || token.compare(0, nonce.size(), nonce) != 0 || token[nonce.size()] != '-') {
+        return false;
+    }
+    char* end = nullptr;
+    version = std::strtoull(token.c_str() + nonce.size() + 1, &end, 10);
+    return end && *end == '\0';
+}
+
+HttpResponsePtr cachedScanResponse(const std::string& ifNoneMatch) {
+    uint64_t version = 0;
+    auto networks = WiFiManagerService::getInstance().scanNetworks(false, &version);
+
+    std::string etag;
+    std::string body;
+    {
+        std::lock_guard<std::mutex> lock(serializedScanMutex);
+        if (!serializedScan.valid || serializedScan.version != version) {
+            serializedScan.version = version;
+            serializedScan.valid = true;
+            serializedScan.etag = "\"" + versionToken(version) + "\"";
+            JsonWriter json;
+            WiFiController::writeScanResponse(json, networks, versionToken(version));
+            serializedScan.body = json.str();
+        }
+        etag = serializedScan.etag;
+        if (!HttpHeaders::etagMatches(ifNoneMatch, etag)) {
+            body = serializedScan.body;
+        }
+    }
+
+    auto resp = HttpResponse::newHttpResponse();
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", "no-cache");
+    if (body.empty()) {
+        resp->setStatusCode(k304NotModified);
+    } else {
+        resp->setContentTypeCode(CT_APPLICATION_JSON);
+        resp->setBody(std::move(body));
+    }
+    return resp;
+}
+
+// ?since=<version>: only what changed after that version, or the full list when it's too old to diff against
+HttpResponsePtr deltaScanResponse(const std::string& since) {
+    uint64_t sinceVersion = 0;
+    ScanDelta delta;
+    if (!parseVersionToken(since, sinceVersion) ||
+        !WiFiManagerService::getInstance().getScanDelta(sinceVersion, delta)) {
+        return cachedScanResponse("");
+    }
+
+    JsonWriter json;
+    json.beginObject()
+        .field("status", "success")
+        .field("scan_type", "delta")
+        .field("since", since)
+        .field("version", versionToken(delta.toVersion))
+        .key("added").beginArray();
+    for (const auto& network : delta.added) {
+        WiFiController::writeNetwork(json, network);
+    }
+    json.endArray().key("changed").beginArray();
+    for (const auto& network : delta.changed) {
+        WiFiController::writeNetwork(json, network);
+    }
+    json.endArray().key("removed").beginArray();
+    for (const auto& id : delta.removed) {
+        json.value(id);
+    }
+    json.endArray().endObject();
+
+    auto resp = jsonResponse(json);
+    resp->addHeader("Cache-Control", "no-cache");
+    return resp;
+}
+
+}
 
 void WiFiController::scanNetworks(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
     // Check for full_scan parameter
@@ -12,116 +133,223 @@ void WiFiController::scanNetworks(const HttpRequestPtr& req, std::function<void(
         full_scan = (params.at("full_scan") == "true" || params.at("full_scan") == "1");
     }
 
-    auto& wifiService = WiFiManagerService::getInstance();
-    auto networks = wifiService.scanNetworks(full_scan);
+    // A full scan takes the hotspot down, so it is queued until nobody else on the AP is mid-wizard;
+    // the client gets the run to wait for and an estimate, then picks the results up with ?since=
+    if (full_scan) {
+        MAESTRO_HANDLER_LATENCY("WiFiController::scanNetworks");
+        bool force = req->getParameter("force") == "true" || req->getParameter("force") == "1";
+        std::string address;
+        std::string mac = CaptiveSessions::getInstance().clientMac(CaptivePortalController::clientKey(req, address));
+        FullScanTicket ticket = ScanScheduler::getInstance().request("api", force, mac);
 
-    Json::Value jsonResponse;
-    jsonResponse["status"] = "success";
-    jsonResponse["scan_type"] = full_scan ? "full" : "cached";
-    jsonResponse["networks"] = Json::Value(Json::arrayValue);
+        JsonWriter json;
+        json.beginObject()
+            .field("status", "queued")
+            .field("scan_type", "full")
+            .field("run", ticket.run)
+            .field("eta_ms", ticket.etaMs)
+            .field("waiting_for", ticket.waitingFor)
+            .endObject();
+        auto resp = jsonResponse(json, k202Accepted);
+        resp->addHeader("Cache-Control", "no-cache");
+        callback(resp);
+        return;
+    }
 
-    for (const auto& network : networks) {
-        Json::Value networkJson;
-        networkJson["ssid"] = network.ssid;
-        networkJson["signal"] = network.signal;
-        networkJson["security"] = network.security;
-        jsonResponse["networks"].append(networkJson);
+    // Once the cache is warm the answer never touches the radio, so it stays on the IO thread
+    std::string ifNoneMatch = req->getHeader("If-None-Match");
+    std::string since = req->getParameter("since");
+    if (WiFiManagerService::getInstance().hasCachedNetworks()) {
+        MAESTRO_HANDLER_LATENCY("WiFiController::scanNetworks");
+        callback(since.empty() ? cachedScanResponse(ifNoneMatch) : deltaScanResponse(since));
+        return;
     }
 
-    auto resp = HttpResponse::newHttpJsonResponse(jsonResponse);
+    // Nothing cached yet means nothing a client could hold a version of, so this is always the full list
+    runBlocking("scan", std::move(callback), [ifNoneMatch]() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::scanNetworks");
+        return cachedScanResponse(ifNoneMatch);
+    });
+}
+
+void WiFiController::getScanSchedule(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    MAESTRO_HANDLER_LATENCY("WiFiController::getScanSchedule");
+
+    auto status = ScanScheduler::getInstance().getStatus();
+    JsonWriter json;
+    json.beginObject()
+        .field("status", "success")
+        .field("pending", status.pending)
+        .field("running", status.running)
+        .field("forced", status.forced)
+        .field("completed_runs", status.completedRuns)
+        .field("eta_ms", status.etaMs)
+        .field("waiting_for", status.waitingFor)
+        .field("stations", status.stations)
+        .field("active_stations", status.activeStations)
+        .field("last_run_ms_ago", status.lastRunAgoMs)
+        .field("max_ap_outage_ms", WiFiUtils::getLastMaxApOutageMs())
+        .endObject();
+
+    auto resp = jsonResponse(json);
+    resp->addHeader("Cache-Control", "no-cache");
     callback(resp);
 }
 
+void WiFiController::writeScanResponse(JsonWriter& json, const std::vector<WiFiNetwork>& networks, const std::string& version) {
+    json.beginObject()
+        .field("status", "success")
+        .field("scan_type", "cached")
+        .field("version", version)
+        .key("networks").beginArray();
+    for (const auto& network : networks) {
+        writeNetwork(json, network);
+    }
+    json.endArray().endObject();
+}
+
+void WiFiController::writeNetwork(JsonWriter& json, const WiFiNetwork& network) {
+    json.beginObject()
+        .field("id", WiFiManagerService::networkId(network))
+        .field("ssid", network.ssid)
+        .field("signal", network.signal)
+        .field("security", network.security)
+        .endObject();
+}
+
 void WiFiController::connectToNetwork(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
     auto jsonBody = req->getJsonObject();
     if (!jsonBody) {
-        Json::Value error;
-        error["status"] = "error";
-        error["message"] = "Invalid JSON body";
-        auto resp = HttpResponse::newHttpJsonResponse(error);
-        resp->setStatusCode(k400BadRequest);
-        callback(resp);
+        MAESTRO_HANDLER_LATENCY("WiFiController::connectToNetwork");
+        JsonWriter json;
+        json.beginObject().field("status", "error").field("message", "Invalid JSON body").endObject();
+        callback(jsonResponse(json, k400BadRequest));
         return;
     }
     
     std::string ssid = (*jsonBody)["ssid"].asString();
     std::string password = (*jsonBody)["password"].asString();
     
-    auto& wifiService = WiFiManagerService::getInstance();
-    bool success = wifiService.connectToNetwork(ssid, password);
-    
-    Json::Value response;
-    response["status"] = success ? "success" : "error";
-    if (!success) {
-        response["message"] = "Failed to connect to network";
-    }
-    
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    if (!success) {
-        resp->setStatusCode(k500InternalServerError);
-    }
-    callback(resp);
+    runBlocking("connect", std::move(callback), [ssid, password]() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::connectToNetwork");
+
+        auto& wifiService = WiFiManagerService::getInstance();
+        bool success = wifiService.connectToNetwork(ssid, password);
+        
+        JsonWriter json;
+        json.beginObject().field("status", success ? "success" : "error");
+        if (!success) {
+            json.field("message", "Failed to connect to network");
+        }
+        json.endObject();
+
+        return jsonResponse(json, success ? k200OK : k500InternalServerError);
+    });
 }
 
 void WiFiController::getStatus(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& wifiService = WiFiManagerService::getInstance();
-    auto status = wifiService.getConnectionStatus();
-    
-    Json::Value response;
-    response["status"] = "success";
-    response["connected"] = status.connected;
-    response["ssid"] = status.ssid;
-    response["signal"] = status.signal;
-    
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+    runBlocking("status", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::getStatus");
+
+        auto& wifiService = WiFiManagerService::getInstance();
+        auto status = wifiService.getConnectionStatus();
+        
+        JsonWriter json;
+        json.beginObject()
+            .field("status", "success")
+            .field("connected", status.connected)
+            .field("ssid", status.ssid)
+            .field("signal", status.signal);
+        if (status.connected) {
+            json.key("link").beginObject()
+                .field("bssid", status.link.bssid)
+                .field("frequency", status.link.frequency)
+                .field("signal_dbm", status.link.signalDbm);
+            if (status.link.signalAvgDbm != 0) {
+                json.field("signal_avg_dbm", status.link.signalAvgDbm);
+            }
+            json.field("tx_bitrate_mbps", status.link.txBitrateMbps)
+                .field("rx_bitrate_mbps", status.link.rxBitrateMbps)
+                .field("tx_retries", status.link.txRetries)
+                .field("tx_failed", status.link.txFailed)
+                .endObject();
+        }
+        json.endObject();
+
+        return jsonResponse(json);
+    });
 }
 
 void WiFiController::disconnect(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& wifiService = WiFiManagerService::getInstance();
-    bool success = wifiService.disconnect();
-    
-    Json::Value response;
-    response["status"] = success ? "success" : "error";
-    if (!success) {
-        response["message"] = "Failed to disconnect";
-    }
-    
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+    // Shares the connect class so a disconnect never races an association in progress
+    runBlocking("connect", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::disconnect");
+
+        auto& wifiService = WiFiManagerService::getInstance();
+        bool success = wifiService.disconnect();
+        
+        JsonWriter json;
+        json.beginObject().field("status", success ? "success" : "error");
+        if (!success) {
+            json.field("message", "Failed to disconnect");
+        }
+        json.endObject();
+
+        return jsonResponse(json);
+    });
 }
 
 void WiFiController::validateConnectivity(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
-    auto& wifiService = WiFiManagerService::getInstance();
+    std::string clientAddress;
+    uint64_t clientKey = CaptivePortalController::clientKey(req, clientAddress);
 
-    Json::Value response;
-    response["status"] = "success";
+    runBlocking("validate", std::move(callback), [clientKey, clientAddress]() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::validateConnectivity");
 
-    // Check if we're connected to WiFi
-    auto status = wifiService.getConnectionStatus();
-    response["wifi_connected"] = status.connected;
-    response["ssid"] = status.ssid;
+        auto& wifiService = WiFiManagerService::getInstance();
 
-    if (status.connected) {
-        // Validate internet connectivity
-        bool hasInternet = wifiService.validateInternetConnectivity();
-        response["internet_connected"] = hasInternet;
-        response["message"] = hasInternet ? "Full connectivity validated" : "WiFi connected but no internet access";
-    } else {
-        response["internet_connected"] = false;
-        response["message"] = "Not connected to WiFi";
-    }
+        JsonWriter json;
+        json.beginObject().field("status", "success");
 
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+        // Check if we're connected to WiFi
+        auto status = wifiService.getConnectionStatus();
+        json.field("wifi_connected", status.connected).field("ssid", status.ssid);
+
+        if (status.connected) {
+            // Validate internet connectivity
+            bool hasInternet = wifiService.validateInternetConnectivity();
+            json.field("internet_connected", hasInternet)
+                .field("message", hasInternet ? "Full connectivity validated" : "WiFi connected but no internet access");
+
+            // The user is a couple of wizard steps away from "Start Home Assistant"; fetch it now
+            if (hasInternet) {
+                HomeAssistantService::getInstance().prepareAsync("connectivity_validated");
+                // This client's setup is done; its OS probes get the real online answer from now on
+                CaptiveSessions::getInstance().markComplete(clientKey, clientAddress);
+            }
+        } else {
+            json.field("internet_connected", false).field("message", "Not connected to WiFi");
+        }
+        json.endObject();
+
+        return jsonResponse(json);
+    });
 }
 
 void WiFiController::resetNetwork(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    runBlocking("service", std::move(callback), []() {
+        MAESTRO_HANDLER_LATENCY("WiFiController::resetNetwork");
+        return resetNetworkResponse();
+    });
+}
+
+HttpResponsePtr WiFiController::resetNetworkResponse() {
     auto& wifiService = WiFiManagerService::getInstance();
     auto& config = ConfigManager::getInstance();
     auto& logger = Logger::getInstance();
 
-    Json::Value response;
+    const char* status = "error";
+    std::string message;
 
     try {
         logger.info("Network reset requested");
@@ -137,34 +365,37 @@ void WiFiController::resetNetwork(const HttpRequestPtr& req, std::function<void(
             std::string hotspotService = config.get("HOTSPOT_SERVICE_NAME", "maestro-hotspot.service");
             std::string dhcpService = config.get("DHCP_SERVICE_NAME", "maestro-dhcp.service");
 
-            logger.info("Starting hotspot service: " + hotspotService);
+            MAESTRO_LOG_INFO("Starting hotspot service: {}", hotspotService);
             std::string startHotspotCmd = "systemctl start " + hotspotService;
-            int hotspotResult = system(startHotspotCmd.c_str());
+            int hotspotResult = Subprocess::run(startHotspotCmd);
 
-            logger.info("Starting DHCP service: " + dhcpService);
+            MAESTRO_LOG_INFO("Starting DHCP service: {}", dhcpService);
             std::string startDhcpCmd = "systemctl start " + dhcpService;
-            int dhcpResult = system(startDhcpCmd.c_str());
+            int dhcpResult = Subprocess::run(startDhcpCmd);
+
+            // Clients marked done in the previous setup must see the portal again
+            CaptiveSessions::getInstance().clear();
 
             if (hotspotResult == 0 && dhcpResult == 0) {
                 logger.info("Hotspot services started successfully");
-                response["status"] = "success";
-                response["message"] = "Network reset complete. Hotspot is now active.";
+                status = "success";
+                message = "Network reset complete. Hotspot is now active.";
             } else {
-                logger.error("Failed to start hotspot services (hotspot=" + std::to_string(hotspotResult) + ", dhcp=" + std::to_string(dhcpResult) + ")");
-                response["status"] = "warning";
-                response["message"] = "WiFi disconnected but failed to start hotspot";
+                MAESTRO_LOG_ERROR("Failed to start hotspot services (hotspot={}, dhcp={})", hotspotResult, dhcpResult);
+                status = "warning";
+                message = "WiFi disconnected but failed to start hotspot";
             }
         } else {
             logger.error("Failed to disconnect from WiFi");
-            response["status"] = "error";
-            response["message"] = "Failed to disconnect from WiFi";
+            message = "Failed to disconnect from WiFi";
         }
     } catch (const std::exception& e) {
-        logger.error("Network reset exception: " + std::string(e.what()));
-        response["status"] = "error";
-        response["message"] = std::string("Network reset failed: ") + e.what();
+        MAESTRO_LOG_ERROR("Network reset exception: {}", e.what());
+        status = "error";
+        message = std::string("Network reset failed: ") + e.what();
     }
 
-    auto resp = HttpResponse::newHttpJsonResponse(response);
-    callback(resp);
+    JsonWriter json;
+    json.beginObject().field("status", status).field("message", message).endObject();
+    return jsonResponse(json);
 }
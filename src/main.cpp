@@ -3,23 +3,83 @@
 #include <iostream>
 #include <sys/stat.h>
 #include <thread>
+#include <future>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cerrno>
 #include <unistd.h>
+#include <sys/socket.h>
 #include "controllers/CaptivePortalController.h"
 #include "controllers/WiFiController.h"
 #include "controllers/ServiceController.h"
 #include "services/WiFiManagerService.h"
 #include "services/HomeAssistantService.h"
+#include "services/HardwareSecurityService.h"
+#include "services/ScanScheduler.h"
 #include "utils/ConfigManager.h"
 #include "utils/Logger.h"
+#include "utils/StartupTimeline.h"
+#include "utils/Metrics.h"
+#include "utils/SystemBackend.h"
+#include "utils/WebAssets.h"
+#include "utils/BlockingExecutor.h"
+#include "utils/Trace.h"
+#include "utils/Systemd.h"
 
 using namespace drogon;
 
+// The handler only writes the signal number here; the drain runs on a normal thread
+int shutdownPipe[2] = {-1, -1};
+
 void signalHandler(int signum) {
-    std::cout << "Interrupt signal (" << signum << ") received." << std::endl;
+    ssize_t ignored = write(shutdownPipe[1], &signum, sizeof(signum));
+    (void)ignored;
+}
+
+// Stops once in-flight blocking work (scans, connects, service control) has finished, so a restart
+// doesn't cut off a phone mid-wizard. Requests arriving meanwhile get a 503 with Retry-After instead
+// of starting work the drain would have to wait for.
+void drainAndQuit() {
+    int signum = 0;
+    while (read(shutdownPipe[0], &signum, sizeof(signum)) < 0 && errno == EINTR) {
+    }
+    std::cout << "Signal (" << signum << ") received, draining in-flight requests" << std::endl;
+    Systemd::notify("STOPPING=1");
+    ScanScheduler::getInstance().stop();
+
+    auto& executor = BlockingExecutor::getInstance();
+    executor.beginDrain();
+    int timeoutMs = std::stoi(ConfigManager::getInstance().get("DRAIN_TIMEOUT_MS", "10000"));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    if (!executor.waitIdle(std::chrono::milliseconds(timeoutMs))) {
+        MAESTRO_LOG_WARNING("Drain timed out after {} ms, stopping anyway", timeoutMs);
+    }
+
+    // The last tasks handed their responses to the IO loops; a marker queued behind them on every
+    // loop runs only once those have been written out
+    std::vector<std::future<void>> flushed;
+    for (auto* loop : app().getIOLoops()) {
+        auto done = std::make_shared<std::promise<void>>();
+        flushed.push_back(done->get_future());
+        loop->queueInLoop([done]() { done->set_value(); });
+    }
+    for (auto& future : flushed) {
+        if (future.wait_until(deadline) != std::future_status::ready) {
+            MAESTRO_LOG_WARNING("IO loops still busy at the drain deadline, stopping anyway");
+            break;
+        }
+    }
     app().quit();
 }
 
 int main() {
+    auto& timeline = StartupTimeline::getInstance();
+
+    if (pipe(shutdownPipe) != 0) {
+        std::cerr << "Failed to create shutdown pipe" << std::endl;
+        return 1;
+    }
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
 
@@ -31,6 +91,7 @@ int main() {
     if (!config.load(configPath)) {
         std::cerr << "Warning: Could not load configuration file. Using defaults." << std::endl;
     }
+    timeline.mark("config_loaded");
 
     // Initialize logger
     auto& logger = Logger::getInstance();
@@ -43,6 +104,29 @@ int main() {
     else logger.setLevel(Logger::INFO);
 
     logger.info("Maestro Captive Portal starting");
+    timeline.mark("logger_ready");
+
+    // Real shell tools, or the simulated radio for load testing
+    SystemBackend::installFromConfig();
+
+    // Reads TRACE_ENABLED / TRACE_BUFFER_EVENTS, so it has to come after the config
+    Trace::getInstance().setThreadName("main");
+
+    Metrics::getInstance().gauge("maestro_logger_queue_depth", "Log calls waiting on or holding the logger", []() {
+        return static_cast<double>(Logger::getInstance().getQueueDepth());
+    });
+
+    // Services don't depend on each other, so initialize them while Drogon is configured
+    auto wifiInit = std::async(std::launch::async, []() {
+        return WiFiManagerService::getInstance().initialize();
+    });
+    auto haInit = std::async(std::launch::async, []() {
+        return HomeAssistantService::getInstance().initialize();
+    });
+    // Local files and a signature check only; the license server is contacted in the background
+    auto securityInit = std::async(std::launch::async, []() {
+        return HardwareSecurityService::getInstance().initialize();
+    });
 
     // Configure Drogon
     // Create logs directory if it doesn't exist
@@ -53,36 +137,121 @@ int main() {
     // Get port from configuration
     int port = std::stoi(config.get("SERVER_PORT", "8080"));
     app().addListener("0.0.0.0", port);
+
+    // Socket activation: systemd owns the listening socket and keeps it open across restarts and
+    // upgrades, so connections that arrive while no process is serving queue instead of being refused
+    int inheritedFd = -1;
+    for (int fd : Systemd::listenFds()) {
+        if (Systemd::boundPort(fd) == port) inheritedFd = fd;
+    }
+    if (inheritedFd >= 0) {
+        int reusePort = 0;
+        socklen_t length = sizeof(reusePort);
+        getsockopt(inheritedFd, SOL_SOCKET, SO_REUSEPORT, &reusePort, &length);
+        if (!reusePort) {
+            std::cerr << "Inherited socket for port " << port << " needs ReusePort=yes in maestro-captive.socket" << std::endl;
+            return 1;
+        }
+        // Drogon can't adopt a descriptor, so its own socket binds alongside the inherited one
+        // (both SO_REUSEPORT) and is replaced by it just before listen()
+        app().enableReusePort();
+        app().setBeforeListenSockOptCallback([inheritedFd](int fd) {
+            dup2(inheritedFd, fd);
+        });
+        MAESTRO_LOG_INFO("Using socket-activated listener on port {}", port);
+    }
     app().setDocumentRoot("web");
     app().setStaticFilesCacheTime(86400); // 1 day cache for static files
+
+    // Serve the compiled-in web bundle from memory ahead of the on-disk document root
+    if (WebAssets::available()) {
+        app().registerPreRoutingAdvice([](const HttpRequestPtr& req, AdviceCallback&& callback,
+                                          AdviceChainCallback&& chain) {
+            if (auto resp = CaptivePortalController::serveEmbeddedAsset(req)) {
+                callback(resp);
+                return;
+            }
+            chain();
+        });
+    }
     
-    // Set thread pool size
-    app().setThreadNum(4);
+    // IO threads only parse, route and answer from memory; anything that blocks goes to the executor
+    app().setThreadNum(std::stoi(config.get("SERVER_THREADS", "4")));
+    BlockingExecutor::getInstance().start();
     
-    // Initialize services
-    auto& wifiService = WiFiManagerService::getInstance();
-    auto& haService = HomeAssistantService::getInstance();
-
-    if (!wifiService.initialize()) {
+    // Wait for service initialization
+    if (!wifiInit.get()) {
         std::cerr << "Failed to initialize WiFi Manager Service" << std::endl;
         return 1;
     }
 
-    if (!haService.initialize()) {
+    if (!haInit.get()) {
         std::cerr << "Failed to initialize Home Assistant Service" << std::endl;
         return 1;
     }
 
+    if (!securityInit.get()) {
+        std::cerr << "Failed to initialize Hardware Security Service" << std::endl;
+        return 1;
+    }
+    timeline.mark("services_initialized");
+
+    // Full scans from the API and the boot scan below all queue here
+    ScanScheduler::getInstance().start();
+    WiFiManagerService::getInstance().startPassiveScanHarvest();
+    HomeAssistantService::getInstance().startIdlePreparation();
+
     std::cout << "Maestro Captive Portal started on port " << port << std::endl;
 
-    // Perform initial WiFi scan on startup in background thread
-    std::thread([]() {
-        sleep(2); // Wait for server to fully start
-        std::cout << "Performing initial WiFi scan..." << std::endl;
-        auto& wifiService = WiFiManagerService::getInstance();
-        wifiService.scanNetworks(true); // Full scan on startup
-        std::cout << "Initial WiFi scan completed" << std::endl;
-    }).detach();
+    // Name the IO threads the first time each one handles a request
+    app().registerPreRoutingAdvice([](const HttpRequestPtr&) {
+        static std::atomic<int> ioThreads{0};
+        thread_local bool named = false;
+        if (!named) {
+            named = true;
+            Trace::getInstance().setThreadName("http-io-" + std::to_string(ioThreads++));
+        }
+    });
+
+    app().registerPreSendingAdvice([](const HttpRequestPtr&, const HttpResponsePtr&) {
+        static std::atomic<bool> firstRequestServed{false};
+        StartupTimeline::getInstance().markOnce(firstRequestServed, "first_request_served");
+    });
+
+    // Beginning advices run once the listeners are up; kick off the initial WiFi scan from there
+    app().registerBeginningAdvice([]() {
+        StartupTimeline::getInstance().mark("listener_ready");
+        std::thread([]() {
+            Trace::getInstance().setThreadName("initial-scan");
+            auto& wifiService = WiFiManagerService::getInstance();
+
+            // A provisioned device goes straight back online; the hotspot and its full scan are only for setup
+            if (wifiService.reconnectLastNetwork()) {
+                std::cout << "Reconnected to last known network, skipping hotspot mode" << std::endl;
+                Systemd::notify("READY=1\nSTATUS=Reconnected to last known network");
+                // Provisioned but Home Assistant never started: have it ready for when it is
+                HomeAssistantService::getInstance().prepareAsync("boot");
+                return;
+            }
+
+            // Goes through the scheduler like any other full scan, so it waits if a phone has already
+            // joined the hotspot and started the wizard
+            std::cout << "Performing initial WiFi scan..." << std::endl;
+            auto& scheduler = ScanScheduler::getInstance();
+            auto ticket = scheduler.request("boot", false);
+            if (!scheduler.waitForRun(ticket.run, std::chrono::seconds(60))) {
+                std::cout << "Initial WiFi scan deferred, stations are active on the hotspot" << std::endl;
+            } else {
+                std::cout << "Initial WiFi scan completed" << std::endl;
+            }
+
+            // Ready means the wizard's first scan request is answered from cache
+            auto networks = wifiService.scanNetworks(false);
+            Systemd::notify("READY=1\nSTATUS=Serving setup portal, " + std::to_string(networks.size()) + " networks cached");
+        }).detach();
+    });
+
+    std::thread(drainAndQuit).detach();
 
     // Run the application
     app().run();
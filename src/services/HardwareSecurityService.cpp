@@ -1,4 +1,105 @@
 #include "services/HardwareSecurityService.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/Subprocess.h"
+#include <json/json.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+namespace {
+
+int64_t epochSeconds() {
+    return static_cast<int64_t>(std::time(nullptr));
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return "";
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// sysfs and device-tree values end in a newline or NUL
+std::string trimmed(std::string value) {
+    while (!value.empty() && (value.back() == '\n' || value.back() == '\0' || value.back() == ' ')) {
+        value.pop_back();
+    }
+    return value;
+}
+
+std::string cpuIdentity() {
+    std::istringstream cpuinfo(readFile("/proc/cpuinfo"));
+    std::string line;
+    std::string model;
+    while (std::getline(cpuinfo, line)) {
+        // ARM boards expose a per-chip serial; x86 only has the model
+        if (line.compare(0, 6, "Serial") == 0) {
+            return trimmed(line.substr(line.find(':') + 1));
+        }
+        if (model.empty() && line.compare(0, 10, "model name") == 0) {
+            model = trimmed(line.substr(line.find(':') + 1));
+        }
+    }
+    return model;
+}
+
+// Burned-in MACs only: virtual interfaces and randomized or user-set addresses would change the fingerprint
+std::vector<std::string> permanentMacs() {
+    namespace fs = std::filesystem;
+    std::vector<std::string> macs;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator("/sys/class/net", error)) {
+        std::string base = entry.path().string();
+        if (!fs::exists(base + "/device", error)) continue;
+        if (trimmed(readFile(base + "/addr_assign_type")) != "0") continue;
+        std::string mac = trimmed(readFile(base + "/address"));
+        if (!mac.empty()) macs.push_back(mac);
+    }
+    std::sort(macs.begin(), macs.end());
+    return macs;
+}
+
+std::string toHex(const unsigned char* data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(length * 2);
+    for (size_t i = 0; i < length; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+bool base64UrlDecode(const std::string& input, std::string& output) {
+    std::string standard = input;
+    std::replace(standard.begin(), standard.end(), '-', '+');
+    std::replace(standard.begin(), standard.end(), '_', '/');
+    while (standard.size() % 4 != 0) standard += '=';
+
+    std::vector<unsigned char> decoded(standard.size() / 4 * 3);
+    int length = EVP_DecodeBlock(decoded.data(), reinterpret_cast<const unsigned char*>(standard.data()),
+                                 static_cast<int>(standard.size()));
+    // EVP_DecodeBlock counts the padding as zero bytes
+    size_t padding = standard.size() - standard.find_last_not_of('=') - 1;
+    if (length < 0 || padding > static_cast<size_t>(length)) return false;
+    output.assign(reinterpret_cast<const char*>(decoded.data()), length - padding);
+    return true;
+}
+
+} // namespace
 
 HardwareSecurityService& HardwareSecurityService::getInstance() {
     static HardwareSecurityService instance;
@@ -6,10 +107,188 @@ HardwareSecurityService& HardwareSecurityService::getInstance() {
 }
 
 bool HardwareSecurityService::initialize() {
+    auto& config = ConfigManager::getInstance();
+    enabled = config.get("ENABLE_HARDWARE_SECURITY", "false") == "true";
+    if (!enabled) {
+        return true;
+    }
+
+    fingerprint = computeFingerprint();
+    cachePath = config.get("LICENSE_CACHE_FILE", "/var/lib/maestro/license-verdict");
+    if (!loadPublicKey(config.get("LICENSE_PUBLIC_KEY_FILE", "config/license-public.pem"))) {
+        Logger::getInstance().error("License public key missing or unreadable, device stays unlicensed");
+        return true;
+    }
+
+    // A cached token is still signed, so it is re-verified rather than trusted
+    std::string cached = trimmed(readFile(cachePath));
+    if (!cached.empty() && !acceptToken(cached, false)) {
+        Logger::getInstance().warning("Cached license verdict failed verification, waiting for a refresh");
+    }
+
+    std::thread(&HardwareSecurityService::refreshLoop, this).detach();
     return true;
 }
 
 bool HardwareSecurityService::validateLicense() {
-    // TODO: Implement hardware-based license validation
+    if (!enabled) return true;
+    return epochSeconds() < licensedUntil.load(std::memory_order_relaxed);
+}
+
+LicenseVerdict HardwareSecurityService::getVerdict() {
+    std::lock_guard<std::mutex> lock(verdictMutex);
+    return verdict;
+}
+
+std::string HardwareSecurityService::computeFingerprint() {
+    std::string board = trimmed(readFile("/sys/class/dmi/id/board_serial"));
+    if (board.empty()) board = trimmed(readFile("/proc/device-tree/serial-number"));
+    if (board.empty()) board = trimmed(readFile("/sys/class/dmi/id/product_uuid"));
+
+    std::string material = "board=" + board + "\ncpu=" + cpuIdentity() + "\n";
+    for (const auto& mac : permanentMacs()) {
+        material += "mac=" + mac + "\n";
+    }
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_Digest(material.data(), material.size(), digest, &length, EVP_sha256(), nullptr);
+    return toHex(digest, length);
+}
+
+bool HardwareSecurityService::loadPublicKey(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) return false;
+    publicKey = PEM_read_PUBKEY(file, nullptr, nullptr, nullptr);
+    fclose(file);
+    return publicKey != nullptr;
+}
+
+bool HardwareSecurityService::verifyToken(const std::string& token, LicenseVerdict& result) {
+    if (!publicKey) return false;
+
+    size_t dot = token.find('.');
+    std::string payload;
+    std::string signature;
+    if (dot == std::string::npos || !base64UrlDecode(token.substr(0, dot), payload) ||
+        !base64UrlDecode(token.substr(dot + 1), signature)) {
+        return false;
+    }
+
+    // Ed25519 signs the message itself; RSA and ECDSA keys sign its SHA-256
+    int keyType = EVP_PKEY_base_id(publicKey);
+    const EVP_MD* digest = (keyType == EVP_PKEY_ED25519 || keyType == EVP_PKEY_ED448) ? nullptr : EVP_sha256();
+
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    if (!ctx || EVP_DigestVerifyInit(ctx.get(), nullptr, digest, nullptr, publicKey) != 1 ||
+        EVP_DigestVerify(ctx.get(), reinterpret_cast<const unsigned char*>(signature.data()), signature.size(),
+                         reinterpret_cast<const unsigned char*>(payload.data()), payload.size()) != 1) {
+        return false;
+    }
+
+    Json::Value json;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    if (!reader->parse(payload.data(), payload.data() + payload.size(), &json, nullptr) || !json.isObject()) {
+        return false;
+    }
+    if (json["fingerprint"].asString() != fingerprint) {
+        return false;
+    }
+
+    result.licensed = json["licensed"].asBool();
+    result.fingerprint = json["fingerprint"].asString();
+    result.issuedAt = json["issued"].asInt64();
+    result.expiresAt = json["expires"].asInt64();
     return true;
 }
+
+bool HardwareSecurityService::acceptToken(const std::string& token, bool persist) {
+    LicenseVerdict verified;
+    if (!verifyToken(token, verified)) {
+        return false;
+    }
+
+    {
+        // A replayed or delayed older token must not roll back a newer verdict
+        std::lock_guard<std::mutex> lock(verdictMutex);
+        if (verified.issuedAt < verdict.issuedAt) {
+            MAESTRO_LOG_WARNING("Ignoring license token issued at {}, older than the current one from {}",
+                                verified.issuedAt, verdict.issuedAt);
+            return false;
+        }
+        verdict = verified;
+        licensedUntil = verified.licensed ? verified.expiresAt : 0;
+    }
+
+    if (persist) {
+        mkdir(cachePath.substr(0, cachePath.rfind('/')).c_str(), 0755);
+
+        // Write then rename so a power cut never leaves a half-written token
+        std::string tmpPath = cachePath + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::trunc);
+            file << token << "\n";
+        }
+        std::rename(tmpPath.c_str(), cachePath.c_str());
+    }
+    return true;
+}
+
+bool HardwareSecurityService::refreshFromServer() {
+    std::string url = ConfigManager::getInstance().get("LICENSE_SERVER_URL", "");
+    if (url.empty()) return false;
+
+    // The fingerprint is hex, so it needs no escaping on the command line
+    int status = 0;
+    std::string body = Subprocess::capture(
+        "curl -s --fail --connect-timeout 10 --max-time 30 -H 'Content-Type: application/json' "
+        "-d '{\"fingerprint\":\"" + fingerprint + "\"}' '" + url + "'", &status);
+
+    bool accepted = status == 0 && acceptToken(trimmed(body), true);
+    Metrics::getInstance().counter("maestro_license_refresh_total", "Background license refreshes by result",
+                                   accepted ? "result=\"success\"" : "result=\"failure\"").inc();
+    return accepted;
+}
+
+void HardwareSecurityService::refreshLoop() {
+    auto& config = ConfigManager::getInstance();
+    int64_t interval = std::max(60, std::stoi(config.get("LICENSE_REFRESH_INTERVAL_SEC", "86400")));
+    int64_t retry = std::max(10, std::stoi(config.get("LICENSE_RETRY_SEC", "600")));
+
+    // Measured on the steady clock, so a wall clock that jumps at boot can't stretch the retry delay
+    bool attempted = false;
+    std::chrono::steady_clock::time_point lastAttempt;
+
+    while (true) {
+        // Refresh once a day, and sooner when the verdict has less than an interval left to run;
+        // never more often than the retry delay, whatever the server hands back
+        int64_t due;
+        {
+            std::lock_guard<std::mutex> lock(verdictMutex);
+            due = verdict.issuedAt == 0 ? 0 : std::min(verdict.issuedAt + interval, verdict.expiresAt - interval);
+        }
+        int64_t wait = due - epochSeconds();
+        if (attempted) {
+            auto sinceAttempt = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - lastAttempt).count();
+            wait = std::max<int64_t>(wait, retry - sinceAttempt);
+        }
+        if (wait > 0) {
+            // In steps of at most the retry delay, recomputing each time: before NTP has synced the
+            // wall clock can be years behind, which would otherwise put the refresh years away
+            std::this_thread::sleep_for(std::chrono::seconds(std::min(wait, retry)));
+            continue;
+        }
+
+        attempted = true;
+        lastAttempt = std::chrono::steady_clock::now();
+        if (refreshFromServer()) {
+            auto current = getVerdict();
+            MAESTRO_LOG_INFO("License verdict refreshed: {} until {}",
+                             current.licensed ? "licensed" : "not licensed", current.expiresAt);
+        } else {
+            Logger::getInstance().warning("License refresh failed, keeping the cached verdict");
+        }
+    }
+}
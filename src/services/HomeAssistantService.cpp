@@ -1,8 +1,26 @@
 #include "services/HomeAssistantService.h"
+#include "utils/BlockingExecutor.h"
 #include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/Subprocess.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <string>
 #include <sstream>
+#include <thread>
+
+namespace {
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
 
 HomeAssistantService& HomeAssistantService::getInstance() {
     static HomeAssistantService instance;
@@ -14,38 +32,229 @@ bool HomeAssistantService::initialize() {
     return true;
 }
 
-bool HomeAssistantService::start() {
+std::string HomeAssistantService::composeCommand(const std::string& args) {
     auto& config = ConfigManager::getInstance();
     std::string dockerPath = config.get("DOCKER_COMPOSE_PATH", "/opt/maestro");
     std::string serviceName = config.get("HOME_ASSISTANT_SERVICE_NAME", "homeassistant");
 
     std::stringstream cmd;
-    cmd << "cd " << dockerPath << " && docker-compose up -d " << serviceName;
-
-    int result = system(cmd.str().c_str());
-    return result == 0;
+    cmd << "cd " << dockerPath << " && docker-compose " << args << " " << serviceName;
+    return cmd.str();
 }
 
-bool HomeAssistantService::stop() {
+// The pull, unpack and create run inside dockerd and containerd, not the docker-compose client, so
+// niceness on the client does nothing; their cgroup weights are what the portal competes with
+void HomeAssistantService::throttleDocker(bool throttle) {
     auto& config = ConfigManager::getInstance();
-    std::string dockerPath = config.get("DOCKER_COMPOSE_PATH", "/opt/maestro");
-    std::string serviceName = config.get("HOME_ASSISTANT_SERVICE_NAME", "homeassistant");
+    std::lock_guard<std::mutex> lock(throttleMutex);
+    if (!throttle) {
+        for (const auto& saved : savedWeights) {
+            Subprocess::run("systemctl set-property --runtime " + saved.first + " " + saved.second + " 2>/dev/null");
+        }
+        savedWeights.clear();
+        return;
+    }
 
-    std::stringstream cmd;
-    cmd << "cd " << dockerPath << " && docker-compose stop " << serviceName;
+    std::string weight = config.get("HA_PREPARE_WEIGHT", "10");
+    if (!savedWeights.empty() || weight.empty() || weight == "0") return;
+
+    std::istringstream units(config.get("HA_PREPARE_DOCKER_UNITS", "docker.service containerd.service"));
+    std::string unit;
+    while (units >> unit) {
+        // "100", or "[not set]" / "" for the default, which an empty assignment restores
+        std::string restore;
+        for (const char* property : {"CPUWeight", "IOWeight"}) {
+            std::string value = Subprocess::capture("systemctl show -p " + std::string(property) + " --value " + unit +
+                                                    " 2>/dev/null");
+            value.erase(std::remove_if(value.begin(), value.end(), [](unsigned char c) { return std::isspace(c); }),
+                        value.end());
+            if (value.empty() || !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+                value.clear();
+            }
+            restore += std::string(restore.empty() ? "" : " ") + property + "=" + value;
+        }
+        if (Subprocess::run("systemctl set-property --runtime " + unit + " CPUWeight=" + weight + " IOWeight=" + weight +
+                            " 2>/dev/null") == 0) {
+            savedWeights.emplace_back(unit, restore);
+        }
+    }
+}
+
+HomeAssistantStart HomeAssistantService::start() {
+    MAESTRO_TRACE_SPAN("service", "homeassistant_start");
+
+    bool liftThrottle = false;
+    {
+        std::lock_guard<std::mutex> lock(prepareMutex);
+        if (preparing) {
+            // The user is waiting now; the pull in flight finishes at full speed and starts the container
+            startWhenPrepared = true;
+            prepareStatus.startPending = true;
+            liftThrottle = true;
+        } else if (prepareStatus.state != "ready") {
+            // Pulling inline would hold a service worker for minutes
+            beginPrepare("start", false);
+            startWhenPrepared = true;
+            prepareStatus.startPending = true;
+            return HomeAssistantStart::Pending;
+        }
+    }
+    if (liftThrottle) {
+        throttleDocker(false);
+        return HomeAssistantStart::Pending;
+    }
 
-    int result = system(cmd.str().c_str());
+    int result = Subprocess::run(composeCommand("up -d"));
+    return result == 0 ? HomeAssistantStart::Started : HomeAssistantStart::Failed;
+}
+
+bool HomeAssistantService::stop() {
+    MAESTRO_TRACE_SPAN("service", "homeassistant_stop");
+    int result = Subprocess::run(composeCommand("stop"));
     return result == 0;
 }
 
 bool HomeAssistantService::isRunning() {
+    int result = Subprocess::run(composeCommand("ps") + " | grep -q Up");
+    return result == 0;
+}
+
+void HomeAssistantService::prepareAsync(const std::string& trigger) {
+    if (ConfigManager::getInstance().get("HA_PREPARE", "true") != "true") return;
+
+    std::lock_guard<std::mutex> lock(prepareMutex);
+    if (prepareStatus.state == "ready") return;
+    beginPrepare(trigger, true);
+}
+
+bool HomeAssistantService::beginPrepare(const std::string& trigger, bool throttled) {
+    if (preparing) return false;
+    preparing = true;
+    startWhenPrepared = false;
+    prepareStartedMs = steadyMs();
+    prepareStatus = HomeAssistantPrepareStatus();
+    prepareStatus.state = "pulling";
+    prepareStatus.trigger = trigger;
+
+    MAESTRO_LOG_INFO("Preparing Home Assistant in the background ({})", trigger);
+    std::thread([this, throttled]() {
+        Trace::getInstance().setThreadName("ha-prepare");
+        prepare(throttled);
+    }).detach();
+    return true;
+}
+
+void HomeAssistantService::prepare(bool throttled) {
+    // Recreating a running container to pick up a fresh image would take Home Assistant down
+    if (isRunning()) {
+        std::lock_guard<std::mutex> lock(prepareMutex);
+        prepareStatus.state = "ready";
+        prepareStatus.detail = "already running";
+        prepareStatus.elapsedMs = steadyMs() - prepareStartedMs;
+        prepareStatus.startPending = false;
+        preparing = false;
+        return;
+    }
+
+    // Not when start() has already been asked for, since the user is waiting on it
+    {
+        std::lock_guard<std::mutex> lock(prepareMutex);
+        throttled = throttled && !startWhenPrepared;
+    }
+    if (throttled) {
+        throttleDocker(true);
+    }
+
+    auto& metrics = Metrics::getInstance();
+    auto step = [&](const char* name, const std::string& args) {
+        TraceSpan span("homeassistant", name);
+        auto started = std::chrono::steady_clock::now();
+        bool ok = Subprocess::run(composeCommand(args) + " >/dev/null 2>&1") == 0;
+        metrics.histogram("maestro_homeassistant_prepare_seconds", "Background Home Assistant preparation steps",
+                          std::string("step=\"") + name + "\"", Metrics::slowOperationBuckets())
+            .observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        return ok;
+    };
+
+    // Offline or rate-limited pulls are fine as long as an image is already on the device
+    bool pulled = step("pull", "pull --quiet");
+
+    {
+        std::lock_guard<std::mutex> lock(prepareMutex);
+        prepareStatus.state = "creating";
+        if (!pulled) prepareStatus.detail = "image pull failed, using the local image";
+    }
+
+    bool created = step("create", "up --no-start");
+    if (throttled) {
+        throttleDocker(false);
+    }
+
+    bool startNow;
+    {
+        std::lock_guard<std::mutex> lock(prepareMutex);
+        prepareStatus.state = created ? "ready" : "failed";
+        if (!created) prepareStatus.detail = pulled ? "container creation failed" : "image unavailable";
+        prepareStatus.elapsedMs = steadyMs() - prepareStartedMs;
+        startNow = startWhenPrepared;
+    }
+
+    if (created) {
+        Logger::getInstance().info("Home Assistant prepared, container created and ready to start");
+    } else {
+        Logger::getInstance().warning("Home Assistant preparation failed; start will pull and create it");
+    }
+
+    // Cleared only after the start, so a start() meanwhile sees a preparation in flight and doesn't race it
+    if (startNow) {
+        bool started = Subprocess::run(composeCommand("up -d")) == 0;
+        MAESTRO_LOG_INFO("Home Assistant start after preparation: {}", started ? "started" : "failed");
+    }
+    std::lock_guard<std::mutex> lock(prepareMutex);
+    prepareStatus.startPending = false;
+    startWhenPrepared = false;
+    preparing = false;
+}
+
+void HomeAssistantService::startIdlePreparation() {
     auto& config = ConfigManager::getInstance();
-    std::string dockerPath = config.get("DOCKER_COMPOSE_PATH", "/opt/maestro");
-    std::string serviceName = config.get("HOME_ASSISTANT_SERVICE_NAME", "homeassistant");
+    if (config.get("HA_PREPARE", "true") != "true" || std::stoi(config.get("HA_PREPARE_IDLE_CHECK_SEC", "600")) <= 0) {
+        return;
+    }
+    std::thread([this]() {
+        Trace::getInstance().setThreadName("ha-idle");
+        idleLoop();
+    }).detach();
+}
 
-    std::stringstream cmd;
-    cmd << "cd " << dockerPath << " && docker-compose ps " << serviceName << " | grep -q Up";
+void HomeAssistantService::idleLoop() {
+    auto& config = ConfigManager::getInstance();
+    int checkSeconds = std::stoi(config.get("HA_PREPARE_IDLE_CHECK_SEC", "600"));
+    double maxLoad = std::stod(config.get("HA_PREPARE_IDLE_LOAD", "0.5"));
 
-    int result = system(cmd.str().c_str());
-    return result == 0;
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(checkSeconds));
+        {
+            std::lock_guard<std::mutex> lock(prepareMutex);
+            if (preparing || prepareStatus.state == "ready") continue;
+        }
+
+        // Nothing queued or running for the portal, and the 1-minute load per core is low
+        double load[1] = {0};
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        bool quiet = getloadavg(load, 1) == 1 && load[0] / cores < maxLoad &&
+                     BlockingExecutor::getInstance().waitIdle(std::chrono::milliseconds(0));
+        if (quiet) {
+            prepareAsync("idle");
+        }
+    }
+}
+
+HomeAssistantPrepareStatus HomeAssistantService::getPrepareStatus() {
+    std::lock_guard<std::mutex> lock(prepareMutex);
+    HomeAssistantPrepareStatus status = prepareStatus;
+    if (preparing) {
+        status.elapsedMs = steadyMs() - prepareStartedMs;
+    }
+    return status;
 }
@@ -0,0 +1,237 @@
+#include "services/ScanScheduler.h"
+#include "services/WiFiManagerService.h"
+#include "utils/BlockingExecutor.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/SystemBackend.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace {
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Counter& requestCounter(const std::string& result) {
+    return Metrics::getInstance().counter("maestro_full_scan_requests_total",
+                                          "Full-scan requests: queued for the next run or covered by the running one",
+                                          "result=\"" + result + "\"");
+}
+
+}
+
+ScanScheduler& ScanScheduler::getInstance() {
+    static ScanScheduler instance;
+    return instance;
+}
+
+ScanScheduler::ScanScheduler() {
+    auto& config = ConfigManager::getInstance();
+    minIntervalMs = std::stoi(config.get("FULL_SCAN_MIN_INTERVAL_SEC", "120")) * 1000LL;
+    stationIdleMs = std::stoi(config.get("FULL_SCAN_STATION_IDLE_SEC", "60")) * 1000LL;
+    recheckMs = std::max(1, std::stoi(config.get("FULL_SCAN_RECHECK_SEC", "5"))) * 1000LL;
+}
+
+void ScanScheduler::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (started) return;
+        started = true;
+    }
+    std::thread(&ScanScheduler::workerLoop, this).detach();
+    // Without station events the periodic refresh still catches phones coming and going
+    SystemBackend::get().startApEventMonitor([this](const std::string& event, const std::string& mac) {
+        onStationEvent(event, mac);
+    });
+}
+
+void ScanScheduler::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    pending = false;
+    wake.notify_all();
+}
+
+FullScanTicket ScanScheduler::request(const std::string& requestTrigger, bool force, const std::string& requesterMac) {
+    int64_t now = steadyMs();
+    bool stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stale = now - stationsRefreshedMs >= recheckMs;
+    }
+    if (stale) refreshStations(now);
+
+    static Counter& queued = requestCounter("queued");
+    static Counter& joined = requestCounter("joined_running");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    FullScanTicket ticket;
+    ticket.run = completedRuns + 1;
+
+    // The scan under way started after every earlier request, so it covers this one too
+    if (running) {
+        joined.inc();
+        ticket.waitingFor = "running";
+        return ticket;
+    }
+
+    queued.inc();
+    if (!pending) {
+        pending = true;
+        trigger = requestTrigger;
+        requestedAtMs = now;
+    }
+    forced = forced || force;
+    if (!requesterMac.empty()) exempt.insert(requesterMac);
+
+    ticket.etaMs = evaluate(now, ticket.waitingFor);
+    wake.notify_all();
+    return ticket;
+}
+
+bool ScanScheduler::waitForRun(uint64_t run, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return finished.wait_for(lock, timeout, [this, run]() { return completedRuns >= run; });
+}
+
+ScanSchedulerStatus ScanScheduler::getStatus() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t now = steadyMs();
+
+    ScanSchedulerStatus status;
+    status.pending = pending;
+    status.running = running;
+    status.forced = forced;
+    status.completedRuns = completedRuns;
+    status.etaMs = pending ? std::max<int64_t>(0, etaMs - (now - etaComputedMs)) : 0;
+    status.waitingFor = pending ? waitingFor : (running ? "running" : "");
+    status.stations = static_cast<int>(stations.size());
+    for (const auto& entry : stations) {
+        if (entry.second.inactiveMs + (now - entry.second.observedAtMs) < stationIdleMs) {
+            ++status.activeStations;
+        }
+    }
+    status.lastRunAgoMs = lastRunEndMs == 0 ? -1 : now - lastRunEndMs;
+    return status;
+}
+
+int64_t ScanScheduler::evaluate(int64_t nowMs, std::string& reason) {
+    int64_t wait = 0;
+    reason.clear();
+    if (lastRunEndMs != 0 && lastRunEndMs + minIntervalMs > nowMs) {
+        wait = lastRunEndMs + minIntervalMs - nowMs;
+        reason = "min_interval";
+    }
+
+    // Assume a busy station stays busy, so the estimate is when the last one would go idle
+    if (!forced) {
+        int64_t stationWait = 0;
+        for (const auto& entry : stations) {
+            if (exempt.count(entry.first)) continue;
+            int64_t inactive = entry.second.inactiveMs + (nowMs - entry.second.observedAtMs);
+            stationWait = std::max(stationWait, stationIdleMs - inactive);
+        }
+        if (stationWait > wait) {
+            wait = stationWait;
+            reason = "active_stations";
+        }
+    }
+
+    etaMs = wait;
+    etaComputedMs = nowMs;
+    waitingFor = reason;
+    return wait;
+}
+
+void ScanScheduler::refreshStations(int64_t nowMs) {
+    std::vector<ApStation> current;
+    // No answer means hostapd isn't running, and then there is nobody to disconnect
+    if (!SystemBackend::get().apStations(current)) {
+        current.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stations.clear();
+    for (const auto& station : current) {
+        stations[station.mac] = StationSeen{station.inactiveMs, nowMs};
+    }
+    stationsRefreshedMs = nowMs;
+}
+
+void ScanScheduler::onStationEvent(const std::string& event, const std::string& mac) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (event == "AP-STA-CONNECTED") {
+        stations[mac] = StationSeen{0, steadyMs()};
+    } else {
+        stations.erase(mac);
+        // A departure can be what the pending run was waiting for
+        wake.notify_all();
+    }
+}
+
+void ScanScheduler::workerLoop() {
+    Trace::getInstance().setThreadName("scan-scheduler");
+    static Histogram& waitHistogram = Metrics::getInstance().histogram(
+        "maestro_full_scan_wait_seconds", "Time from the first full-scan request to the run that served it", "",
+        Metrics::slowOperationBuckets());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (!pending) {
+            wake.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        refreshStations(steadyMs());
+        lock.lock();
+        if (stopping || !pending) continue;
+
+        std::string reason;
+        int64_t wait = evaluate(steadyMs(), reason);
+        if (wait > 0) {
+            wake.wait_for(lock, std::chrono::milliseconds(std::min(wait, recheckMs)));
+            continue;
+        }
+
+        pending = false;
+        running = true;
+        std::string runTrigger = trigger;
+        bool runForced = forced;
+        forced = false;
+        exempt.clear();
+        waitHistogram.observe((steadyMs() - requestedAtMs) / 1000.0);
+        lock.unlock();
+
+        MAESTRO_LOG_INFO("Starting scheduled full scan (trigger: {}{})", runTrigger, runForced ? ", forced" : "");
+        runFullScan();
+
+        lock.lock();
+        running = false;
+        ++completedRuns;
+        lastRunEndMs = steadyMs();
+        finished.notify_all();
+    }
+}
+
+void ScanScheduler::runFullScan() {
+    // On the executor, so a shutdown drain waits for the hotspot to come back up
+    auto done = std::make_shared<std::promise<void>>();
+    auto future = done->get_future();
+    bool submitted = BlockingExecutor::getInstance().submit("full_scan", [done]() {
+        WiFiManagerService::getInstance().scanNetworks(true);
+        done->set_value();
+    });
+    if (!submitted) {
+        // Refused while draining (or full): scanning here would take the hotspot down where the drain can't see it
+        MAESTRO_LOG_WARNING("Skipping scheduled full scan, the executor refused it");
+        return;
+    }
+    future.wait();
+}
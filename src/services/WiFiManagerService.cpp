@@ -1,7 +1,36 @@
 #include "services/WiFiManagerService.h"
 #include "utils/WiFiUtils.h"
+#include "utils/Logger.h"
+#include "utils/ConfigManager.h"
+#include "utils/StartupTimeline.h"
+#include "utils/Subprocess.h"
+#include "utils/Metrics.h"
+#include "utils/Trace.h"
+#include "utils/WpaProfiles.h"
+#include "utils/SystemBackend.h"
 #include <thread>
+#include <future>
 #include <chrono>
+#include <set>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace {
+
+bool sameNetwork(const WiFiNetwork& a, const WiFiNetwork& b) {
+    return a.ssid == b.ssid && a.signal == b.signal && a.security == b.security &&
+           a.bssid == b.bssid && a.frequency == b.frequency;
+}
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
 
 WiFiManagerService& WiFiManagerService::getInstance() {
     static WiFiManagerService instance;
@@ -13,90 +42,355 @@ bool WiFiManagerService::initialize() {
     return true;
 }
 
-std::vector<WiFiNetwork> WiFiManagerService::scanNetworks(bool full_scan) {
+std::vector<WiFiNetwork> WiFiManagerService::scanNetworks(bool full_scan, uint64_t* version) {
+    MAESTRO_TRACE_SPAN("service", "scanNetworks");
     // If not doing full scan and we have cached results, return them
     if (!full_scan) {
         std::lock_guard<std::mutex> lock(cacheMutex);
         if (!cachedNetworks.empty()) {
+            if (version) *version = cacheVersion;
             return cachedNetworks;
         }
     }
 
     // Perform actual scan
+    ++ownScansRunning;
     auto scanResults = WiFiUtils::scanNetworks(full_scan);
-    std::vector<WiFiNetwork> networks;
+    lastOwnScanEndMs = steadyMs();
+    --ownScansRunning;
+    if (full_scan) {
+        MAESTRO_LOG_INFO("Full scan found {} networks, longest AP outage {} ms", scanResults.size(),
+                         WiFiUtils::getLastMaxApOutageMs());
+    }
 
-    for (const auto& result : scanResults) {
-        WiFiNetwork network;
-        network.ssid = result.ssid;
-        network.signal = result.signal_strength;
-        network.security = result.security;
-        networks.push_back(network);
+    // Fold into the rolling table and rebuild the cache from it
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    aggregateScanResults(scanResults, full_scan);
+    if (!cachedNetworks.empty()) {
+        StartupTimeline::getInstance().markOnce(firstScanAvailable, "first_scan_available");
     }
+    if (version) *version = cacheVersion;
+    return cachedNetworks;
+}
 
-    // Update cache
-    {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        cachedNetworks = networks;
+bool WiFiManagerService::hasCachedNetworks() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return !cachedNetworks.empty();
+}
+
+void WiFiManagerService::aggregateScanResults(const std::vector<WiFiScanResult>& results, bool full_scan,
+                                              bool countMisses) {
+    auto& config = ConfigManager::getInstance();
+    double alpha = std::stod(config.get("SCAN_SIGNAL_ALPHA", "0.4"));
+    int maxMisses = std::stoi(config.get("SCAN_MAX_MISSES", "3"));
+    auto maxAge = std::chrono::seconds(std::stoi(config.get("SCAN_MAX_AGE_SEC", "300")));
+    auto now = std::chrono::steady_clock::now();
+
+    std::set<std::string> seen;
+    std::set<int> coveredFrequencies;
+
+    for (const auto& result : results) {
+        std::string key = result.bssid.empty() ? result.ssid : result.bssid;
+        seen.insert(key);
+        coveredFrequencies.insert(result.frequency);
+
+        auto it = networkTable.find(key);
+        if (it == networkTable.end()) {
+            TrackedNetwork tracked;
+            tracked.smoothedSignal = result.signal_strength;
+            tracked.firstSeen = now;
+            it = networkTable.emplace(key, tracked).first;
+        } else {
+            it->second.smoothedSignal = alpha * result.signal_strength + (1.0 - alpha) * it->second.smoothedSignal;
+        }
+
+        TrackedNetwork& tracked = it->second;
+        tracked.network.ssid = result.ssid;
+        tracked.network.security = result.security;
+        tracked.network.bssid = result.bssid;
+        tracked.network.frequency = result.frequency;
+        tracked.lastSeen = now;
+        tracked.consecutiveMisses = 0;
+    }
+
+    // A quick scan only covers the AP's channel, so only count misses on channels it actually saw.
+    // An empty result is treated as a failed scan rather than every network vanishing at once.
+    for (auto it = networkTable.begin(); it != networkTable.end();) {
+        TrackedNetwork& tracked = it->second;
+        if (countMisses && seen.count(it->first) == 0 && !results.empty() &&
+            (full_scan || coveredFrequencies.count(tracked.network.frequency) > 0)) {
+            ++tracked.consecutiveMisses;
+        }
+
+        if (tracked.consecutiveMisses >= maxMisses || now - tracked.lastSeen > maxAge) {
+            it = networkTable.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::vector<WiFiNetwork> rebuilt;
+    for (const auto& entry : networkTable) {
+        WiFiNetwork network = entry.second.network;
+        network.signal = static_cast<int>(std::lround(entry.second.smoothedSignal));
+        rebuilt.push_back(network);
     }
+    std::sort(rebuilt.begin(), rebuilt.end(), [](const WiFiNetwork& a, const WiFiNetwork& b) {
+        return a.signal > b.signal;
+    });
+
+    // Only a visible change bumps the version, so clients holding the current ETag keep getting 304s
+    if (rebuilt.size() != cachedNetworks.size() ||
+        !std::equal(rebuilt.begin(), rebuilt.end(), cachedNetworks.begin(), sameNetwork)) {
+        cachedNetworks = std::move(rebuilt);
+        ++cacheVersion;
 
-    return networks;
+        size_t historySize = std::max(1, std::stoi(config.get("SCAN_HISTORY_SIZE", "8")));
+        scanHistory.push_back({cacheVersion, cachedNetworks});
+        while (scanHistory.size() > historySize) {
+            scanHistory.pop_front();
+        }
+    }
+}
+
+void WiFiManagerService::startPassiveScanHarvest() {
+    if (ConfigManager::getInstance().get("PASSIVE_SCAN", "true") != "true") return;
+
+    if (!SystemBackend::get().startScanMonitor([this](const std::string& interface) { harvestScanResults(interface); })) {
+        MAESTRO_LOG_INFO("Scan events unavailable; the scan list refreshes only on the portal's own scans");
+    }
+}
+
+void WiFiManagerService::harvestScanResults(const std::string& interface) {
+    auto& metrics = Metrics::getInstance();
+    static Counter& merged = metrics.counter("maestro_passive_scan_harvests_total",
+                                             "NEW_SCAN_RESULTS events by outcome", "result=\"merged\"");
+    static Counter& own = metrics.counter("maestro_passive_scan_harvests_total",
+                                          "NEW_SCAN_RESULTS events by outcome", "result=\"own_scan\"");
+    static Counter& empty = metrics.counter("maestro_passive_scan_harvests_total",
+                                            "NEW_SCAN_RESULTS events by outcome", "result=\"empty\"");
+
+    if (ownScansRunning > 0 || steadyMs() - lastOwnScanEndMs < 2000) {
+        own.inc();
+        return;
+    }
+
+    auto maxAgeMs = std::stoll(ConfigManager::getInstance().get("PASSIVE_SCAN_MAX_AGE_MS", "10000"));
+    std::vector<WiFiScanResult> results;
+    if (!SystemBackend::get().dumpScanResults(interface, maxAgeMs, results) || results.empty()) {
+        empty.inc();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    aggregateScanResults(results, false, false);
+    if (!cachedNetworks.empty()) {
+        StartupTimeline::getInstance().markOnce(firstScanAvailable, "first_scan_available");
+    }
+    merged.inc();
+}
+
+const std::string& WiFiManagerService::networkId(const WiFiNetwork& network) {
+    return network.bssid.empty() ? network.ssid : network.bssid;
+}
+
+bool WiFiManagerService::getScanDelta(uint64_t since, ScanDelta& delta) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto base = std::find_if(scanHistory.begin(), scanHistory.end(),
+                             [since](const ScanSnapshot& snapshot) { return snapshot.version == since; });
+    if (base == scanHistory.end()) {
+        return false;
+    }
+
+    delta = ScanDelta();
+    delta.fromVersion = since;
+    delta.toVersion = cacheVersion;
+    if (since == cacheVersion) {
+        return true;
+    }
+
+    std::map<std::string, const WiFiNetwork*> previous;
+    for (const auto& network : base->networks) {
+        previous.emplace(networkId(network), &network);
+    }
+    for (const auto& network : cachedNetworks) {
+        auto it = previous.find(networkId(network));
+        if (it == previous.end()) {
+            delta.added.push_back(network);
+            continue;
+        }
+        if (!sameNetwork(*it->second, network)) {
+            delta.changed.push_back(network);
+        }
+        previous.erase(it);
+    }
+    for (const auto& entry : previous) {
+        delta.removed.push_back(entry.first);
+    }
+    return true;
 }
 
 bool WiFiManagerService::connectToNetwork(const std::string& ssid, const std::string& password) {
+    auto& metrics = Metrics::getInstance();
+    auto origin = std::chrono::steady_clock::now();
+    auto phaseStart = origin;
+    auto msSince = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    };
+
+    ConnectAttempt attempt;
+    attempt.ssid = ssid;
+    attempt.startedAtEpochMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Closes the running phase; phases are back to back, so each one starts where the last ended
+    auto endPhase = [&](const char* name, bool ok, const std::string& detail = "") {
+        auto now = std::chrono::steady_clock::now();
+        if (Trace::enabled()) {
+            int64_t durationUs = std::chrono::duration_cast<std::chrono::microseconds>(now - phaseStart).count();
+            Trace::getInstance().record("connect", name, Trace::nowUs() - durationUs, durationUs, detail);
+        }
+        attempt.phases.push_back({name, msSince(origin, phaseStart), msSince(phaseStart, now), ok, detail});
+        metrics.histogram("maestro_wifi_connect_phase_seconds", "Duration of each WiFi connect phase",
+                          "phase=\"" + std::string(name) + "\"", Metrics::slowOperationBuckets())
+            .observe(msSince(phaseStart, now) / 1000.0);
+        phaseStart = now;
+        return ok;
+    };
+    auto finish = [&](bool success) {
+        WpaProfiles::getInstance().finishAttempt(ssid, success);
+        attempt.success = success;
+        attempt.totalMs = msSince(origin, std::chrono::steady_clock::now());
+        for (const auto& phase : attempt.phases) {
+            if (!success && !phase.ok && attempt.failedPhase.empty()) attempt.failedPhase = phase.name;
+        }
+        metrics.counter("maestro_wifi_connect_attempts_total", "WiFi connect attempts by result",
+                        success ? "result=\"success\"" : "result=\"failure\"").inc();
+        recordConnectAttempt(std::move(attempt));
+        return success;
+    };
+
+    // PBKDF2 takes a while on slow SoCs; derive the key while the old network is torn down
+    auto psk = std::async(std::launch::async, [ssid, password]() {
+        auto start = std::chrono::steady_clock::now();
+        std::string key = password.empty() ? std::string() : WiFiUtils::derivePsk(ssid, password);
+        return std::make_pair(key, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    });
+
     // First disconnect from any current network
     std::string currentSSID = WiFiUtils::getCurrentSSID();
     if (!currentSSID.empty()) {
         std::string disconnectCmd = "nmcli connection down '" + currentSSID + "' 2>/dev/null";
-        system(disconnectCmd.c_str());
+        Subprocess::run(disconnectCmd);
+        endPhase("disconnect", true, "from '" + currentSSID + "'");
 
         // Wait a moment for disconnect
         std::this_thread::sleep_for(std::chrono::seconds(1));
+        endPhase("settle", true);
+    } else {
+        endPhase("disconnect", true, "not connected");
     }
 
-    // Attempt connection
-    bool success = WiFiUtils::connectToNetwork(ssid, password);
+    // Only the wait left over after the disconnect counts here; the derivation time goes in the detail
+    auto derived = psk.get();
+    std::string key = derived.first;
+    if (!password.empty() && key.empty()) {
+        MAESTRO_LOG_ERROR("Invalid WPA passphrase for '{}' (must be 8-63 characters)", ssid);
+        endPhase("psk", false, "invalid passphrase (must be 8-63 characters)");
+        return finish(false);
+    }
+    endPhase("psk", true, password.empty() ? "open network" :
+             "derived in " + std::to_string(static_cast<int>(derived.second)) + " ms");
 
-    if (success) {
-        // Validate connection by checking if we can get an IP and the SSID matches
-        for (int i = 0; i < 15; ++i) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Attempt connection
+    if (!endPhase("configure", WiFiUtils::connectToNetwork(ssid, key))) {
+        return finish(false);
+    }
 
-            auto status = getConnectionStatus();
-            if (status.connected && status.ssid == ssid) {
-                return true;
-            }
+    // Association, handshake and DHCP are told apart by polling wpa_state and the interface address
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    std::string state;
+    bool associated = false;
+    bool completed = false;
+    while (std::chrono::steady_clock::now() < deadline) {
+        state = WiFiUtils::getWpaState();
+        if (!associated && (state == "ASSOCIATED" || state == "4WAY_HANDSHAKE" ||
+                            state == "GROUP_HANDSHAKE" || state == "COMPLETED")) {
+            associated = true;
+            endPhase("association", true);
         }
-        // Connection didn't validate within timeout
-        return false;
+        if (state == "COMPLETED") {
+            completed = true;
+            endPhase("handshake", true);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    if (!completed) {
+        endPhase(associated ? "handshake" : "association", false, "timed out in wpa_state=" + state);
+        return finish(false);
     }
 
-    return false;
+    // A missing lease is recorded but doesn't fail the attempt, as before
+    std::string address = WiFiUtils::getIpv4Address();
+    while (address.empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        address = WiFiUtils::getIpv4Address();
+    }
+    endPhase("dhcp", !address.empty(), address.empty() ? "no IPv4 lease before deadline" : address);
+
+    // Validate connection by checking the SSID matches
+    auto status = getConnectionStatus();
+    if (!endPhase("verify", status.connected && status.ssid == ssid,
+                  status.connected ? "associated with '" + status.ssid + "'" : "not connected")) {
+        return finish(false);
+    }
+
+    // Remember the BSS and channel for a targeted reconnect on the next boot
+    LastNetwork record;
+    record.ssid = ssid;
+    record.bssid = status.link.bssid;
+    record.frequency = status.link.frequency;
+    saveLastNetwork(record);
+
+    return finish(true);
+}
+
+void WiFiManagerService::recordConnectAttempt(ConnectAttempt attempt) {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    size_t capacity = std::max(1, std::stoi(ConfigManager::getInstance().get("CONNECT_HISTORY_SIZE", "16")));
+    attempt.id = nextAttemptId++;
+    if (connectHistory.size() < capacity) {
+        connectHistory.push_back(std::move(attempt));
+    } else {
+        // Full: overwrite the oldest
+        connectHistory[connectHistoryNext] = std::move(attempt);
+        connectHistoryNext = (connectHistoryNext + 1) % connectHistory.size();
+    }
+}
+
+std::vector<ConnectAttempt> WiFiManagerService::getRecentConnectAttempts() {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    std::vector<ConnectAttempt> attempts(connectHistory.begin(), connectHistory.end());
+    std::sort(attempts.begin(), attempts.end(), [](const ConnectAttempt& a, const ConnectAttempt& b) {
+        return a.id > b.id;
+    });
+    return attempts;
 }
 
 WiFiStatus WiFiManagerService::getConnectionStatus() {
     WiFiStatus status;
-    status.connected = WiFiUtils::isConnected();
-    status.ssid = WiFiUtils::getCurrentSSID();
-    
-    if (status.connected) {
-        // Get signal strength for current connection
-        FILE* pipe = popen(("nmcli -t -f SIGNAL dev wifi | grep -A1 '" + status.ssid + "' | tail -1").c_str(), "r");
-        if (pipe) {
-            char buffer[32];
-            if (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-                std::string signal_str(buffer);
-                if (!signal_str.empty() && signal_str.back() == '\n') {
-                    signal_str.pop_back();
-                }
-                status.signal = signal_str.empty() ? 0 : std::stoi(signal_str);
-            }
-            pclose(pipe);
-        }
-    } else {
-        status.signal = 0;
+    status.link = WiFiUtils::getLinkStats();
+
+    // Associated is not enough; the handshake has to have finished too, which the AP's authorized flag shows
+    status.connected = status.link.associated && status.link.authorized;
+    status.ssid = status.connected ? status.link.ssid : "";
+    if (status.connected && status.ssid.empty()) {
+        status.ssid = WiFiUtils::getCurrentSSID();
     }
-    
+
+    int dbm = status.link.signalAvgDbm != 0 ? status.link.signalAvgDbm : status.link.signalDbm;
+    status.signal = status.connected ? std::min(100, std::max(0, (dbm + 100) * 2)) : 0;
     return status;
 }
 
@@ -107,24 +401,110 @@ bool WiFiManagerService::disconnect() {
     }
 
     std::string disconnectCmd = "nmcli connection down '" + currentSSID + "'";
-    int result = system(disconnectCmd.c_str());
+    int result = Subprocess::run(disconnectCmd);
     return result == 0;
 }
 
 bool WiFiManagerService::validateInternetConnectivity() {
+    static Histogram& latency = Metrics::getInstance().histogram(
+        "maestro_connectivity_validation_seconds", "validateInternetConnectivity latency", "",
+        Metrics::slowOperationBuckets());
+    ScopedLatency timer(latency);
+
     // Test internet connectivity with multiple methods
     
     // Method 1: Ping Google DNS
-    int result1 = system("ping -c 1 -W 3 8.8.8.8 >/dev/null 2>&1");
-    if (result1 == 0) return true;
+    bool online = Subprocess::run("ping -c 1 -W 3 8.8.8.8 >/dev/null 2>&1") == 0;
     
     // Method 2: Ping Cloudflare DNS
-    int result2 = system("ping -c 1 -W 3 1.1.1.1 >/dev/null 2>&1");
-    if (result2 == 0) return true;
+    if (!online) {
+        online = Subprocess::run("ping -c 1 -W 3 1.1.1.1 >/dev/null 2>&1") == 0;
+    }
     
     // Method 3: Try HTTP request to a reliable endpoint
-    int result3 = system("curl -s --connect-timeout 5 --max-time 10 http://detectportal.firefox.com/success.txt | grep -q success");
-    if (result3 == 0) return true;
+    if (!online) {
+        online = Subprocess::run("curl -s --connect-timeout 5 --max-time 10 http://detectportal.firefox.com/success.txt | grep -q success") == 0;
+    }
+
+    // Only networks that reached the internet qualify for the boot fast path
+    if (online) {
+        LastNetwork record;
+        if (loadLastNetwork(record) && !record.validated && record.ssid == WiFiUtils::getCurrentSSID()) {
+            record.validated = true;
+            saveLastNetwork(record);
+        }
+    }
     
-    return false;
+    return online;
+}
+
+bool WiFiManagerService::reconnectLastNetwork() {
+    auto& config = ConfigManager::getInstance();
+    if (config.get("FAST_RECONNECT", "true") != "true") return false;
+
+    LastNetwork record;
+    if (!loadLastNetwork(record) || !record.validated) return false;
+
+    int timeoutMs = std::stoi(config.get("FAST_RECONNECT_TIMEOUT_MS", "6000"));
+    MAESTRO_LOG_INFO("Reconnecting to last network '{}' ({}, {} MHz)", record.ssid, record.bssid, record.frequency);
+
+    bool success;
+    {
+        static Histogram& latency = Metrics::getInstance().histogram(
+            "maestro_fast_reconnect_seconds", "Targeted reconnect to the last network at boot", "",
+            Metrics::slowOperationBuckets());
+        ScopedLatency timer(latency);
+        success = WiFiUtils::reconnectKnownNetwork(record.ssid, record.bssid, record.frequency, timeoutMs);
+    }
+    Metrics::getInstance().counter("maestro_fast_reconnect_total", "Boot-time reconnects to the last network by result",
+                                   success ? "result=\"success\"" : "result=\"failure\"").inc();
+
+    if (!success) {
+        // Back to setup mode
+        MAESTRO_LOG_WARNING("Fast reconnect to '{}' failed, starting hotspot", record.ssid);
+        Subprocess::run("systemctl start maestro-hostapd maestro-dnsmasq 2>/dev/null");
+        return false;
+    }
+
+    StartupTimeline::getInstance().mark("last_network_reconnected");
+    return true;
+}
+
+bool WiFiManagerService::loadLastNetwork(LastNetwork& record) {
+    std::string path = ConfigManager::getInstance().get("LAST_NETWORK_FILE", "/var/lib/maestro/last-network");
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) continue;
+        std::string key = line.substr(0, pos);
+        std::string value = line.substr(pos + 1);
+        if (key == "SSID") record.ssid = value;
+        else if (key == "BSSID") record.bssid = value;
+        else if (key == "FREQUENCY") record.frequency = std::atoi(value.c_str());
+        else if (key == "VALIDATED") record.validated = (value == "true");
+    }
+    return !record.ssid.empty();
+}
+
+void WiFiManagerService::saveLastNetwork(const LastNetwork& record) {
+    std::string path = ConfigManager::getInstance().get("LAST_NETWORK_FILE", "/var/lib/maestro/last-network");
+    mkdir(path.substr(0, path.rfind('/')).c_str(), 0755);
+
+    // Write then rename so a power cut never leaves a half-written record
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file.is_open()) {
+            MAESTRO_LOG_WARNING("Cannot write last network record {}", path);
+            return;
+        }
+        file << "SSID=" << record.ssid << "\n"
+             << "BSSID=" << record.bssid << "\n"
+             << "FREQUENCY=" << record.frequency << "\n"
+             << "VALIDATED=" << (record.validated ? "true" : "false") << "\n";
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
 }
@@ -0,0 +1,216 @@
+#include "utils/BlockingExecutor.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+
+struct ClassDefaults {
+    const char* name;
+    int limit;
+    int queueCap;
+};
+
+// One radio means one full scan and one association at a time; cheap status queries can overlap
+const ClassDefaults kDefaults[] = {
+    {"scan", 1, 8},
+    {"full_scan", 1, 2},
+    {"connect", 1, 2},
+    {"validate", 2, 8},
+    {"service", 1, 4},
+    {"status", 2, 16},
+};
+
+std::string configKey(const std::string& prefix, const std::string& name) {
+    std::string key = prefix + name;
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::toupper(c); });
+    return key;
+}
+
+}
+
+BlockingExecutor& BlockingExecutor::getInstance() {
+    static BlockingExecutor instance;
+    return instance;
+}
+
+BlockingExecutor::~BlockingExecutor() {
+    stop();
+}
+
+void BlockingExecutor::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!workers.empty()) return;
+
+    for (const auto& defaults : kDefaults) {
+        operationClass(defaults.name);
+    }
+
+    int threads = std::max(1, std::stoi(ConfigManager::getInstance().get("EXEC_WORKER_THREADS", "6")));
+    stopping = false;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            Trace::getInstance().setThreadName("executor-" + std::to_string(i));
+            workerLoop();
+        });
+    }
+    MAESTRO_LOG_INFO("Blocking executor started with {} workers", threads);
+}
+
+void BlockingExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+
+    // Workers exit without draining the queues; tell whoever is waiting on those tasks
+    std::vector<QueuedTask> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : classes) {
+            for (auto& task : entry.second.queue) abandoned.push_back(std::move(task));
+            entry.second.queue.clear();
+        }
+    }
+    for (auto& task : abandoned) {
+        if (task.dropped) task.dropped();
+    }
+    idle.notify_all();
+}
+
+BlockingExecutor::OperationClass& BlockingExecutor::operationClass(const std::string& name) {
+    auto it = classes.find(name);
+    if (it != classes.end()) return it->second;
+
+    int limit = 1;
+    int queueCap = 4;
+    for (const auto& defaults : kDefaults) {
+        if (name == defaults.name) {
+            limit = defaults.limit;
+            queueCap = defaults.queueCap;
+        }
+    }
+
+    auto& config = ConfigManager::getInstance();
+    OperationClass opClass;
+    opClass.name = name;
+    opClass.limit = std::max(1, std::stoi(config.get(configKey("EXEC_LIMIT_", name), std::to_string(limit))));
+    opClass.queueCap = std::max(0, std::stoi(config.get(configKey("EXEC_QUEUE_", name), std::to_string(queueCap))));
+    return classes.emplace(name, std::move(opClass)).first->second;
+}
+
+bool BlockingExecutor::submit(const std::string& opClass, std::function<void()> task, std::function<void()> onDropped) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (draining) return false;
+        OperationClass& target = operationClass(opClass);
+        if (workers.empty() || target.queue.size() >= target.queueCap) {
+            Metrics::getInstance()
+                .counter("maestro_executor_rejected_total", "Blocking operations shed because their queue was full",
+                         "class=\"" + opClass + "\"")
+                .inc();
+            return false;
+        }
+        target.queue.push_back({std::move(task), std::move(onDropped), std::chrono::steady_clock::now()});
+    }
+    available.notify_one();
+    return true;
+}
+
+int BlockingExecutor::retryAfterSeconds(const std::string& opClass) {
+    std::lock_guard<std::mutex> lock(mutex);
+    OperationClass& target = operationClass(opClass);
+    double waves = static_cast<double>(target.queue.size() + target.running) / target.limit;
+    return std::max(1, static_cast<int>(std::ceil(waves * target.avgSeconds)));
+}
+
+void BlockingExecutor::beginDrain() {
+    std::lock_guard<std::mutex> lock(mutex);
+    draining = true;
+}
+
+bool BlockingExecutor::isDraining() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return draining;
+}
+
+bool BlockingExecutor::waitIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return idle.wait_for(lock, timeout, [this]() {
+        for (const auto& entry : classes) {
+            if (entry.second.running > 0 || !entry.second.queue.empty()) return false;
+        }
+        return true;
+    });
+}
+
+// Round-robin over classes that have work and a free slot, so one busy class can't starve the rest
+bool BlockingExecutor::takeNext(OperationClass*& opClass, QueuedTask& task) {
+    if (classes.empty()) return false;
+
+    auto it = classes.begin();
+    std::advance(it, nextClass % classes.size());
+    for (size_t i = 0; i < classes.size(); ++i) {
+        OperationClass& candidate = it->second;
+        if (!candidate.queue.empty() && candidate.running < candidate.limit) {
+            task = std::move(candidate.queue.front());
+            candidate.queue.pop_front();
+            ++candidate.running;
+            opClass = &candidate;
+            nextClass = (nextClass + i + 1) % classes.size();
+            return true;
+        }
+        if (++it == classes.end()) it = classes.begin();
+    }
+    return false;
+}
+
+void BlockingExecutor::workerLoop() {
+    auto& metrics = Metrics::getInstance();
+
+    while (true) {
+        OperationClass* opClass = nullptr;
+        QueuedTask task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [&]() { return stopping || takeNext(opClass, task); });
+            if (!opClass) return;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        metrics.histogram("maestro_executor_queue_wait_seconds", "Time blocking operations waited for a worker",
+                          "class=\"" + opClass->name + "\"")
+            .observe(std::chrono::duration<double>(started - task.enqueued).count());
+        if (Trace::enabled()) {
+            int64_t waitedUs = std::chrono::duration_cast<std::chrono::microseconds>(started - task.enqueued).count();
+            Trace::getInstance().record("executor", "queue_wait", Trace::nowUs() - waitedUs, waitedUs, opClass->name);
+        }
+
+        try {
+            task.run();
+        } catch (const std::exception& e) {
+            MAESTRO_LOG_ERROR("Blocking {} operation threw: {}", opClass->name, e.what());
+        } catch (...) {
+            MAESTRO_LOG_ERROR("Blocking {} operation threw a non-standard exception", opClass->name);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --opClass->running;
+            opClass->avgSeconds = 0.8 * opClass->avgSeconds + 0.2 * seconds;
+        }
+        // A finished task may unblock a queued one of the same class
+        available.notify_all();
+        idle.notify_all();
+    }
+}
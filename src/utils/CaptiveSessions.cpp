@@ -0,0 +1,280 @@
+#include "utils/CaptiveSessions.h"
+#include "utils/ConfigManager.h"
+#include "utils/Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// A client behind the portal probes every few seconds; a quieter one is checked against the ARP table
+// again before its slot is trusted, since its address may have been leased to another device
+constexpr int64_t kMacRecheckMs = 5000;
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+// Looked up once per new client; the hotspot's DHCP clients are always in the kernel's ARP table
+uint64_t arpMac(const std::string& address) {
+    std::ifstream arp("/proc/net/arp");
+    std::string line;
+    std::getline(arp, line); // header
+    while (std::getline(arp, line)) {
+        std::istringstream fields(line);
+        std::string ip, hwType, flags, mac;
+        if (!(fields >> ip >> hwType >> flags >> mac) || ip != address) continue;
+        unsigned int bytes[6];
+        if (std::sscanf(mac.c_str(), "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3],
+                        &bytes[4], &bytes[5]) != 6) {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (unsigned int byte : bytes) value = (value << 8) | (byte & 0xff);
+        return value;
+    }
+    return 0;
+}
+
+std::string formatMac(uint64_t value) {
+    if (value == 0) return "";
+    char text[18];
+    std::snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+                  static_cast<unsigned>(value >> 40) & 0xff, static_cast<unsigned>(value >> 32) & 0xff,
+                  static_cast<unsigned>(value >> 24) & 0xff, static_cast<unsigned>(value >> 16) & 0xff,
+                  static_cast<unsigned>(value >> 8) & 0xff, static_cast<unsigned>(value) & 0xff);
+    return text;
+}
+
+}
+
+CaptiveSessions& CaptiveSessions::getInstance() {
+    static CaptiveSessions instance;
+    return instance;
+}
+
+CaptiveSessions::CaptiveSessions() {
+    auto& config = ConfigManager::getInstance();
+    slotCount = roundUpToPowerOfTwo(std::max(16, std::stoi(config.get("CAPTIVE_SESSION_CAPACITY", "256"))));
+    window = std::min<size_t>(8, slotCount);
+    idleMs = std::max(60, std::stoi(config.get("CAPTIVE_SESSION_IDLE_SEC", "3600"))) * 1000LL;
+    slots.reset(new Slot[slotCount]);
+
+    Metrics::getInstance().gauge("maestro_captive_sessions", "Clients tracked in the captive session table", [this]() {
+        int64_t now = steadyMs();
+        size_t active = 0;
+        for (size_t i = 0; i < slotCount; ++i) {
+            if (slots[i].key.load(std::memory_order_relaxed) != 0 &&
+                now - slots[i].lastSeenMs.load(std::memory_order_relaxed) < idleMs) {
+                ++active;
+            }
+        }
+        return static_cast<double>(active);
+    });
+}
+
+uint64_t CaptiveSessions::keyFor(const std::string& address, uint32_t ipv4NetEndian, bool ipv6) {
+    if (!ipv6) {
+        return (1ULL << 32) | ipv4NetEndian;
+    }
+    // FNV-1a, kept out of the IPv4 range by the top bit
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : address) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash | (1ULL << 63);
+}
+
+CaptiveSessions::Slot* CaptiveSessions::find(uint64_t key, int64_t nowMs) {
+    size_t start = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (slotCount - 1);
+    for (size_t i = 0; i < window; ++i) {
+        Slot& slot = slots[(start + i) & (slotCount - 1)];
+        uint64_t slotKey = slot.key.load(std::memory_order_acquire);
+        if (slotKey == key) {
+            // A slot idle past CAPTIVE_SESSION_IDLE_SEC is most likely a recycled DHCP lease
+            if (nowMs - slot.lastSeenMs.load(std::memory_order_relaxed) >= idleMs) return nullptr;
+            return &slot;
+        }
+        if (slotKey == 0) return nullptr;
+    }
+    return nullptr;
+}
+
+CaptiveSessions::Slot& CaptiveSessions::findOrClaim(uint64_t key, const std::string& address, int64_t nowMs,
+                                                    uint32_t& sequence) {
+    if (Slot* slot = find(key, nowMs)) {
+        sequence = slot->sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) == 0 && slot->key.load(std::memory_order_acquire) == key &&
+            nowMs - slot->lastSeenMs.load(std::memory_order_relaxed) < kMacRecheckMs) {
+            return *slot;
+        }
+    }
+
+    uint64_t mac = arpMac(address);
+
+    std::lock_guard<std::mutex> lock(claimMutex);
+    // Prefer this client's own (stale) slot, then an empty one, then the least recently seen
+    size_t start = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (slotCount - 1);
+    Slot* victim = nullptr;
+    for (size_t i = 0; i < window; ++i) {
+        Slot& slot = slots[(start + i) & (slotCount - 1)];
+        uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+        if (slotKey == key) {
+            uint64_t slotMac = slot.mac.load(std::memory_order_relaxed);
+            bool sameDevice = slotMac == 0 || mac == 0 || slotMac == mac;
+            if (sameDevice && nowMs - slot.lastSeenMs.load(std::memory_order_relaxed) < idleMs) {
+                if (slotMac == 0) slot.mac.store(mac, std::memory_order_relaxed);
+                sequence = slot.sequence.load(std::memory_order_relaxed);
+                return slot;
+            }
+            // Idle past CAPTIVE_SESSION_IDLE_SEC, or the address now belongs to another device
+            victim = &slot;
+            break;
+        }
+        if (slotKey == 0) {
+            victim = &slot;
+            break;
+        }
+        if (!victim || slot.lastSeenMs.load(std::memory_order_relaxed) < victim->lastSeenMs.load(std::memory_order_relaxed)) {
+            victim = &slot;
+        }
+    }
+
+    uint64_t previous = victim->key.load(std::memory_order_relaxed);
+    if (previous != 0 && previous != key &&
+        nowMs - victim->lastSeenMs.load(std::memory_order_relaxed) < idleMs) {
+        static Counter& evictions = Metrics::getInstance().counter(
+            "maestro_captive_session_evictions_total", "Active captive sessions dropped to make room for a new client");
+        evictions.inc();
+    }
+
+    victim->sequence.fetch_add(1, std::memory_order_acq_rel);
+    victim->key.store(key, std::memory_order_relaxed);
+    victim->state.store(static_cast<uint8_t>(CaptiveState::Probing), std::memory_order_relaxed);
+    victim->probes.store(0, std::memory_order_relaxed);
+    victim->portalViews.store(0, std::memory_order_relaxed);
+    victim->firstSeenMs.store(nowMs, std::memory_order_relaxed);
+    victim->lastSeenMs.store(nowMs, std::memory_order_relaxed);
+    victim->mac.store(mac, std::memory_order_relaxed);
+    std::strncpy(victim->address, address.c_str(), sizeof(victim->address) - 1);
+    sequence = victim->sequence.fetch_add(1, std::memory_order_release) + 1;
+    return *victim;
+}
+
+// Slots found lock-free can be re-claimed for another client while a caller updates them. A stray
+// probe or view count landing on the new owner is accepted; state is only read back if the slot
+// kept its owner throughout, and only changed under claimMutex, which every claim holds.
+
+CaptiveState CaptiveSessions::recordProbe(uint64_t key, const std::string& address) {
+    int64_t now = steadyMs();
+    while (true) {
+        uint32_t sequence;
+        Slot& slot = findOrClaim(key, address, now, sequence);
+        slot.probes.fetch_add(1, std::memory_order_relaxed);
+        slot.lastSeenMs.store(now, std::memory_order_relaxed);
+        auto state = static_cast<CaptiveState>(slot.state.load(std::memory_order_acquire));
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) continue;
+        if (setupComplete.load(std::memory_order_relaxed)) return CaptiveState::Complete;
+        return state;
+    }
+}
+
+CaptiveState CaptiveSessions::recordPortalView(uint64_t key, const std::string& address) {
+    int64_t now = steadyMs();
+    while (true) {
+        uint32_t sequence;
+        Slot& slot = findOrClaim(key, address, now, sequence);
+        slot.portalViews.fetch_add(1, std::memory_order_relaxed);
+        slot.lastSeenMs.store(now, std::memory_order_relaxed);
+
+        if (slot.state.load(std::memory_order_acquire) == static_cast<uint8_t>(CaptiveState::Probing)) {
+            std::lock_guard<std::mutex> lock(claimMutex);
+            if (slot.sequence.load(std::memory_order_acquire) != sequence) continue;
+            // markAllComplete doesn't take the lock, so don't overwrite a Complete it just stored
+            uint8_t expected = static_cast<uint8_t>(CaptiveState::Probing);
+            slot.state.compare_exchange_strong(expected, static_cast<uint8_t>(CaptiveState::PortalViewed),
+                                               std::memory_order_acq_rel);
+            return static_cast<CaptiveState>(slot.state.load(std::memory_order_acquire));
+        }
+
+        auto state = static_cast<CaptiveState>(slot.state.load(std::memory_order_acquire));
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) continue;
+        return state;
+    }
+}
+
+std::string CaptiveSessions::clientMac(uint64_t key) {
+    Slot* slot = find(key, steadyMs());
+    return slot ? formatMac(slot->mac.load(std::memory_order_relaxed)) : std::string();
+}
+
+void CaptiveSessions::markComplete(uint64_t key, const std::string& address) {
+    int64_t now = steadyMs();
+    while (true) {
+        uint32_t sequence;
+        Slot& slot = findOrClaim(key, address, now, sequence);
+        std::lock_guard<std::mutex> lock(claimMutex);
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) continue;
+        slot.lastSeenMs.store(now, std::memory_order_relaxed);
+        slot.state.store(static_cast<uint8_t>(CaptiveState::Complete), std::memory_order_release);
+        return;
+    }
+}
+
+void CaptiveSessions::markAllComplete() {
+    setupComplete.store(true, std::memory_order_relaxed);
+    for (size_t i = 0; i < slotCount; ++i) {
+        if (slots[i].key.load(std::memory_order_acquire) != 0) {
+            slots[i].state.store(static_cast<uint8_t>(CaptiveState::Complete), std::memory_order_release);
+        }
+    }
+}
+
+void CaptiveSessions::clear() {
+    std::lock_guard<std::mutex> lock(claimMutex);
+    setupComplete.store(false, std::memory_order_relaxed);
+    for (size_t i = 0; i < slotCount; ++i) {
+        Slot& slot = slots[i];
+        slot.sequence.fetch_add(1, std::memory_order_acq_rel);
+        slot.key.store(0, std::memory_order_relaxed);
+        slot.state.store(static_cast<uint8_t>(CaptiveState::Probing), std::memory_order_relaxed);
+        slot.sequence.fetch_add(1, std::memory_order_release);
+    }
+}
+
+std::vector<CaptiveSession> CaptiveSessions::snapshot() {
+    // Holding the claim lock keeps slots from being reassigned while their addresses are copied
+    std::lock_guard<std::mutex> lock(claimMutex);
+    int64_t now = steadyMs();
+    std::vector<CaptiveSession> sessions;
+    for (size_t i = 0; i < slotCount; ++i) {
+        const Slot& slot = slots[i];
+        if (slot.key.load(std::memory_order_relaxed) == 0 ||
+            now - slot.lastSeenMs.load(std::memory_order_relaxed) >= idleMs) {
+            continue;
+        }
+        CaptiveSession session;
+        session.address = slot.address;
+        session.mac = formatMac(slot.mac.load(std::memory_order_relaxed));
+        session.state = static_cast<CaptiveState>(slot.state.load(std::memory_order_relaxed));
+        session.probes = slot.probes.load(std::memory_order_relaxed);
+        session.portalViews = slot.portalViews.load(std::memory_order_relaxed);
+        session.firstSeenMs = slot.firstSeenMs.load(std::memory_order_relaxed);
+        session.lastSeenMs = slot.lastSeenMs.load(std::memory_order_relaxed);
+        sessions.push_back(session);
+    }
+    std::sort(sessions.begin(), sessions.end(), [](const CaptiveSession& a, const CaptiveSession& b) {
+        return a.lastSeenMs > b.lastSeenMs;
+    });
+    return sessions;
+}
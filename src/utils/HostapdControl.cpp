@@ -0,0 +1,226 @@
+#include "utils/HostapdControl.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Subprocess.h"
+#include "utils/Trace.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool isMacLine(const std::string& line) {
+    if (line.size() != 17) return false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        bool separator = i % 3 == 2;
+        if (separator ? line[i] != ':' : !std::isxdigit(static_cast<unsigned char>(line[i]))) return false;
+    }
+    return true;
+}
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+HostapdControl& HostapdControl::getInstance() {
+    static HostapdControl instance;
+    return instance;
+}
+
+HostapdControl::HostapdControl() {
+    auto& config = ConfigManager::getInstance();
+    interface = config.get("NETWORK_INTERFACE", "wlan0");
+    controlPath = config.get("HOSTAPD_CTRL_DIR", "/var/run/hostapd") + "/" + interface;
+}
+
+HostapdControl::~HostapdControl() {
+    monitoring = false;
+    closeSocket();
+}
+
+int HostapdControl::openSocket(std::string& boundPath) {
+    static std::atomic<int> counter{0};
+
+    int sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+
+    // hostapd replies to the sender's address, so the client end needs a name of its own
+    sockaddr_un local{};
+    local.sun_family = AF_UNIX;
+    boundPath = "/tmp/maestro-hostapd-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+    std::strncpy(local.sun_path, boundPath.c_str(), sizeof(local.sun_path) - 1);
+    unlink(boundPath.c_str());
+
+    sockaddr_un remote{};
+    remote.sun_family = AF_UNIX;
+    std::strncpy(remote.sun_path, controlPath.c_str(), sizeof(remote.sun_path) - 1);
+
+    if (bind(sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+        connect(sock, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) != 0) {
+        close(sock);
+        unlink(boundPath.c_str());
+        boundPath.clear();
+        return -1;
+    }
+
+    timeval timeout{1, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+
+void HostapdControl::closeSocket() {
+    if (fd >= 0) {
+        close(fd);
+        unlink(localPath.c_str());
+        fd = -1;
+    }
+}
+
+bool HostapdControl::request(const std::string& command, std::string& reply) {
+    // A socket from before a hostapd restart points at a dead endpoint; reopen once and retry
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (fd < 0) {
+            fd = openSocket(localPath);
+            if (fd < 0) return false;
+        }
+        if (send(fd, command.data(), command.size(), 0) < 0) {
+            closeSocket();
+            continue;
+        }
+
+        char buffer[4096];
+        ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+        if (length < 0) {
+            closeSocket();
+            return false;
+        }
+        reply.assign(buffer, static_cast<size_t>(length));
+        return true;
+    }
+    return false;
+}
+
+bool HostapdControl::listStations(std::vector<ApStation>& stations) {
+    MAESTRO_TRACE_SPAN("hostapd", "listStations");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string reply;
+        if (request("STA-FIRST", reply)) {
+            std::string all;
+            // Each reply starts with the station's MAC, which names the next one to ask for
+            for (int i = 0; i < 256 && !reply.empty() && reply.compare(0, 4, "FAIL") != 0; ++i) {
+                std::string mac = reply.substr(0, reply.find('\n'));
+                if (!isMacLine(mac)) break;
+                all += reply;
+                if (all.back() != '\n') all += '\n';
+                if (!request("STA-NEXT " + mac, reply)) break;
+            }
+            stations = parseStations(all);
+            return true;
+        }
+    }
+
+    int status = 0;
+    std::string output = Subprocess::capture("hostapd_cli -p " + controlPath.substr(0, controlPath.rfind('/')) +
+                                             " -i " + interface + " all_sta 2>/dev/null", &status);
+    if (status != 0) return false;
+    stations = parseStations(output);
+    return true;
+}
+
+std::vector<ApStation> HostapdControl::parseStations(const std::string& output) {
+    std::vector<ApStation> stations;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (isMacLine(line)) {
+            ApStation station;
+            station.mac = line;
+            stations.push_back(station);
+            continue;
+        }
+        if (stations.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) continue;
+        std::string key = line.substr(0, equals);
+        std::string value = line.substr(equals + 1);
+        try {
+            if (key == "inactive_msec") stations.back().inactiveMs = std::stoll(value);
+            else if (key == "connected_time") stations.back().connectedSeconds = std::stoll(value);
+        } catch (const std::exception&) {
+        }
+    }
+    return stations;
+}
+
+void HostapdControl::startEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent) {
+    if (monitoring.exchange(true)) return;
+    std::thread(&HostapdControl::eventLoop, this, std::move(onEvent)).detach();
+}
+
+void HostapdControl::eventLoop(std::function<void(const std::string&, const std::string&)> onEvent) {
+    Trace::getInstance().setThreadName("hostapd-events");
+
+    while (monitoring) {
+        std::string boundPath;
+        int sock = openSocket(boundPath);
+        char buffer[4096];
+        ssize_t length = -1;
+        if (sock >= 0 && send(sock, "ATTACH", 6, 0) == 6) {
+            length = recv(sock, buffer, sizeof(buffer), 0);
+        }
+        if (length < 2 || std::strncmp(buffer, "OK", 2) != 0) {
+            // hostapd is stopped (full scan, hotspot shut down) or not installed; try again later
+            if (sock >= 0) {
+                close(sock);
+                unlink(boundPath.c_str());
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(5));
+            continue;
+        }
+
+        // PING while quiet: a hostapd restart leaves this socket attached to nothing
+        int64_t lastHeard = steadyMs();
+        while (monitoring) {
+            pollfd pending{sock, POLLIN, 0};
+            int ready = poll(&pending, 1, 10000);
+            if (ready > 0) {
+                length = recv(sock, buffer, sizeof(buffer) - 1, 0);
+                if (length <= 0) break;
+                lastHeard = steadyMs();
+                buffer[length] = '\0';
+
+                // "<3>AP-STA-CONNECTED 02:11:22:33:44:55 [extra fields]"
+                std::string message(buffer);
+                if (!message.empty() && message[0] == '<') {
+                    message.erase(0, message.find('>') + 1);
+                }
+                std::istringstream fields(message);
+                std::string event;
+                std::string mac;
+                fields >> event >> mac;
+                if (event == "AP-STA-CONNECTED" || event == "AP-STA-DISCONNECTED") {
+                    onEvent(event, mac);
+                }
+                continue;
+            }
+            if (steadyMs() - lastHeard > 25000 || send(sock, "PING", 4, 0) != 4) break;
+        }
+
+        close(sock);
+        unlink(boundPath.c_str());
+        Logger::getInstance().info("hostapd control interface went away, reattaching");
+    }
+}
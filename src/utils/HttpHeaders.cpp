@@ -0,0 +1,69 @@
+#include "utils/HttpHeaders.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+std::string trim(const std::string& text, size_t begin, size_t end) {
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+    while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) --end;
+    return text.substr(begin, end - begin);
+}
+
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string weakless(std::string tag) {
+    if (tag.compare(0, 2, "W/") == 0) tag.erase(0, 2);
+    return tag;
+}
+
+}
+
+bool HttpHeaders::etagMatches(const std::string& ifNoneMatch, const std::string& etag) {
+    if (ifNoneMatch.empty()) return false;
+
+    // Comma-separated list of tags or "*"
+    std::string target = weakless(etag);
+    size_t pos = 0;
+    while (pos < ifNoneMatch.size()) {
+        size_t end = ifNoneMatch.find(',', pos);
+        if (end == std::string::npos) end = ifNoneMatch.size();
+        std::string candidate = weakless(trim(ifNoneMatch, pos, end));
+        if (candidate == "*" || (!candidate.empty() && candidate == target)) return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool HttpHeaders::acceptsEncoding(const std::string& acceptEncoding, const std::string& coding) {
+    // "gzip;q=0.8, br, *;q=0": an explicit entry wins over the wildcard, and q=0 means not acceptable
+    double wildcard = -1;
+    size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        size_t end = acceptEncoding.find(',', pos);
+        if (end == std::string::npos) end = acceptEncoding.size();
+
+        size_t semicolon = acceptEncoding.find(';', pos);
+        if (semicolon == std::string::npos || semicolon > end) semicolon = end;
+        std::string token = lower(trim(acceptEncoding, pos, semicolon));
+
+        double quality = 1;
+        size_t param = semicolon;
+        while (param < end) {
+            size_t next = acceptEncoding.find(';', param + 1);
+            if (next == std::string::npos || next > end) next = end;
+            std::string name = lower(trim(acceptEncoding, param + 1, next));
+            if (name.compare(0, 2, "q=") == 0) quality = std::strtod(name.c_str() + 2, nullptr);
+            param = next;
+        }
+
+        if (token == coding) return quality > 0;
+        if (token == "*") wildcard = quality;
+        pos = end + 1;
+    }
+    return wildcard > 0;
+}
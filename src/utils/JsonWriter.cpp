@@ -0,0 +1,231 @@
+#include "utils/JsonWriter.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr size_t kPooledBuffers = 4;
+constexpr size_t kInitialCapacity = 1024;
+// A one-off huge response (a long scan list) shouldn't pin its memory to the thread forever
+constexpr size_t kMaxPooledCapacity = 64 * 1024;
+
+std::vector<std::unique_ptr<std::string>>& bufferPool() {
+    thread_local std::vector<std::unique_ptr<std::string>> pool;
+    return pool;
+}
+
+// Length of the well-formed UTF-8 sequence at data, or 0 if it isn't one
+size_t utf8SequenceLength(const unsigned char* data, size_t remaining) {
+    unsigned char lead = data[0];
+    size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) low = 0xa0;  // overlong
+        if (lead == 0xed) high = 0x9f; // surrogates
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) low = 0x90;  // overlong
+        if (lead == 0xf4) high = 0x8f; // above U+10FFFF
+    } else {
+        return 0;
+    }
+    if (remaining < length) return 0;
+    if (data[1] < low || data[1] > high) return 0;
+    for (size_t i = 2; i < length; ++i) {
+        if (data[i] < 0x80 || data[i] > 0xbf) return 0;
+    }
+    return length;
+}
+
+}
+
+JsonWriter::JsonWriter() {
+    auto& pool = bufferPool();
+    if (!pool.empty()) {
+        buffer = std::move(pool.back());
+        pool.pop_back();
+    } else {
+        buffer.reset(new std::string());
+        buffer->reserve(kInitialCapacity);
+    }
+}
+
+JsonWriter::~JsonWriter() {
+    auto& pool = bufferPool();
+    if (pool.size() < kPooledBuffers && buffer->capacity() <= kMaxPooledCapacity) {
+        buffer->clear();
+        pool.push_back(std::move(buffer));
+    }
+}
+
+void JsonWriter::separate() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    uint64_t bit = 1ULL << (depth & 63);
+    if (nonEmpty & bit) {
+        buffer->push_back(',');
+    }
+    nonEmpty |= bit;
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    buffer->push_back('{');
+    ++depth;
+    nonEmpty &= ~(1ULL << (depth & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    --depth;
+    buffer->push_back('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    buffer->push_back('[');
+    ++depth;
+    nonEmpty &= ~(1ULL << (depth & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    --depth;
+    buffer->push_back(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+    separate();
+    buffer->push_back('"');
+    appendEscaped(*buffer, name, std::strlen(name));
+    buffer->append("\":", 2);
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string& name) {
+    separate();
+    buffer->push_back('"');
+    appendEscaped(*buffer, name.data(), name.size());
+    buffer->append("\":", 2);
+    afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+    separate();
+    buffer->push_back('"');
+    appendEscaped(*buffer, text, std::strlen(text));
+    buffer->push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string& text) {
+    separate();
+    buffer->push_back('"');
+    appendEscaped(*buffer, text.data(), text.size());
+    buffer->push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    if (flag) buffer->append("true", 4);
+    else buffer->append("false", 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    separate();
+    // JSON has no NaN or infinity
+    if (!std::isfinite(number)) {
+        buffer->append("null", 4);
+        return *this;
+    }
+    // Shortest of 15 or 17 significant digits that reads back as the same double, so 415.7 stays 415.7
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%.15g", number);
+    if (std::strtod(text, nullptr) != number) {
+        length = std::snprintf(text, sizeof(text), "%.17g", number);
+    }
+    buffer->append(text, static_cast<size_t>(length));
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    buffer->append("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::signedInteger(int64_t number) {
+    separate();
+    char text[24];
+    auto result = std::to_chars(text, text + sizeof(text), number);
+    buffer->append(text, static_cast<size_t>(result.ptr - text));
+    return *this;
+}
+
+JsonWriter& JsonWriter::unsignedInteger(uint64_t number) {
+    separate();
+    char text[24];
+    auto result = std::to_chars(text, text + sizeof(text), number);
+    buffer->append(text, static_cast<size_t>(result.ptr - text));
+    return *this;
+}
+
+void JsonWriter::appendEscaped(std::string& out, const char* data, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    size_t runStart = 0;
+    size_t i = 0;
+    while (i < size) {
+        unsigned char c = bytes[i];
+        // Plain ASCII is copied in runs
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            ++i;
+            continue;
+        }
+        if (c >= 0x80) {
+            size_t length = utf8SequenceLength(bytes + i, size - i);
+            if (length != 0) {
+                i += length;
+                continue;
+            }
+        }
+
+        out.append(data + runStart, i - runStart);
+        switch (c) {
+            case '"': out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            default:
+                if (c < 0x20) {
+                    char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f]};
+                    out.append(escape, 6);
+                } else {
+                    out.append("\xef\xbf\xbd", 3); // U+FFFD for a byte that isn't valid UTF-8
+                }
+        }
+        ++i;
+        runStart = i;
+    }
+    out.append(data + runStart, size - runStart);
+}
@@ -1,7 +1,10 @@
 #include "utils/Logger.h"
+#include "utils/Trace.h"
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <vector>
 
 Logger& Logger::getInstance() {
@@ -22,11 +25,8 @@ void Logger::openDailyLogFile() {
     }
 
     // Generate filename with today's date
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream dateStream;
-    dateStream << std::put_time(&tm, "%Y-%m-%d");
-    std::string dateStr = dateStream.str();
+    refreshTimestamp();
+    std::string dateStr(cachedTimestamp, 10);
 
     std::string dailyLogPath = baseLogPath + "." + dateStr;
 
@@ -80,7 +80,7 @@ void Logger::cleanupOldLogs() {
 }
 
 void Logger::setLevel(Level level) {
-    minLevel = level;
+    minLevel.store(level, std::memory_order_relaxed);
 }
 
 void Logger::debug(const std::string& message) {
@@ -100,36 +100,45 @@ void Logger::error(const std::string& message) {
 }
 
 void Logger::log(Level level, const std::string& message) {
-    if (level < minLevel) return;
+    if (!enabled(level)) return;
 
+    pendingWrites.fetch_add(1, std::memory_order_relaxed);
     std::lock_guard<std::mutex> lock(logMutex);
 
-    // Check if we need to rotate to a new day's log file
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream dateStream;
-    dateStream << std::put_time(&tm, "%Y-%m-%d");
-    std::string dateStr = dateStream.str();
-
-    if (dateStr != currentLogDate && !baseLogPath.empty()) {
+    // Rotate to a new day's log file when the cached timestamp's date moves on
+    refreshTimestamp();
+    if (!baseLogPath.empty() && currentLogDate.compare(0, std::string::npos, cachedTimestamp, 10) != 0) {
         openDailyLogFile();
     }
 
-    std::string timestamp = getCurrentTime();
-    std::string levelStr = getLevelString(level);
-    std::string logLine = "[" + timestamp + "] [" + levelStr + "] " + message;
+    lineBuffer.assign(1, '[');
+    lineBuffer.append(cachedTimestamp).append("] [").append(getLevelString(level)).append("] ");
+    lineBuffer.append(message).append(1, '\n');
+
+    MAESTRO_TRACE_SPAN("logger", "write");
 
     // Write to file
     if (logFile.is_open()) {
-        logFile << logLine << std::endl;
+        logFile.write(lineBuffer.data(), static_cast<std::streamsize>(lineBuffer.size()));
         logFile.flush();
     }
 
-    // Also write to stderr for systemd journal
-    std::cerr << logLine << std::endl;
+    // Also write to stderr for systemd journal (unit-buffered, so this is the flush too)
+    std::cerr.write(lineBuffer.data(), static_cast<std::streamsize>(lineBuffer.size()));
+
+    pendingWrites.fetch_sub(1, std::memory_order_relaxed);
 }
 
-std::string Logger::getLevelString(Level level) {
+void Logger::refreshTimestamp() {
+    std::time_t now = std::time(nullptr);
+    if (now == cachedSecond) return;
+    cachedSecond = now;
+    std::tm local{};
+    localtime_r(&now, &local);
+    std::strftime(cachedTimestamp, sizeof(cachedTimestamp), "%Y-%m-%d %H:%M:%S", &local);
+}
+
+const char* Logger::getLevelString(Level level) {
     switch (level) {
         case DEBUG: return "DEBUG";
         case INFO: return "INFO";
@@ -139,10 +148,25 @@ std::string Logger::getLevelString(Level level) {
     }
 }
 
-std::string Logger::getCurrentTime() {
-    auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+std::string& Logger::formatBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+void Logger::appendArg(std::string& out, double number) {
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%g", number);
+    out.append(text, static_cast<size_t>(length));
+}
+
+void Logger::appendSigned(std::string& out, int64_t number) {
+    char text[24];
+    auto result = std::to_chars(text, text + sizeof(text), number);
+    out.append(text, result.ptr);
+}
+
+void Logger::appendUnsigned(std::string& out, uint64_t number) {
+    char text[24];
+    auto result = std::to_chars(text, text + sizeof(text), number);
+    out.append(text, result.ptr);
 }
@@ -0,0 +1,155 @@
+#include "utils/Metrics.h"
+#include <algorithm>
+#include <sstream>
+
+size_t metrics::shardIndex() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(const std::vector<double>& bounds) : bounds(bounds) {
+    if (this->bounds.size() > metrics::kMaxBuckets) {
+        this->bounds.resize(metrics::kMaxBuckets);
+    }
+}
+
+void Histogram::observe(double value) {
+    // Last slot is the implicit +Inf bucket
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+    auto& shard = shards[metrics::shardIndex()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sumMicros.fetch_add(static_cast<uint64_t>(std::max(0.0, value) * 1e6), std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> Histogram::bucketCounts() const {
+    std::vector<uint64_t> counts(bounds.size() + 1, 0);
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return counts;
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard.count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double Histogram::sum() const {
+    uint64_t totalMicros = 0;
+    for (const auto& shard : shards) {
+        totalMicros += shard.sumMicros.load(std::memory_order_relaxed);
+    }
+    return totalMicros / 1e6;
+}
+
+Metrics& Metrics::getInstance() {
+    static Metrics instance;
+    return instance;
+}
+
+const std::vector<double>& Metrics::latencyBuckets() {
+    static const std::vector<double> buckets = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+    return buckets;
+}
+
+const std::vector<double>& Metrics::slowOperationBuckets() {
+    static const std::vector<double> buckets = {0.1, 0.25, 0.5, 1, 2, 3, 5, 8, 13, 20, 30, 60};
+    return buckets;
+}
+
+Metrics::Family& Metrics::family(const std::string& name, const std::string& help, const std::string& type) {
+    auto& entry = families[name];
+    if (entry.type.empty()) {
+        entry.help = help;
+        entry.type = type;
+    }
+    return entry;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(familiesMutex);
+    auto& slot = family(name, help, "counter").counters[labels];
+    if (!slot) {
+        slot = std::make_unique<Counter>();
+    }
+    return *slot;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                              const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(familiesMutex);
+    auto& slot = family(name, help, "histogram").histograms[labels];
+    if (!slot) {
+        slot = std::make_unique<Histogram>(bounds);
+    }
+    return *slot;
+}
+
+void Metrics::gauge(const std::string& name, const std::string& help, std::function<double()> read) {
+    std::lock_guard<std::mutex> lock(familiesMutex);
+    family(name, help, "gauge").gauge = std::move(read);
+}
+
+namespace {
+
+std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return name;
+    std::string joined = labels;
+    if (!labels.empty() && !extra.empty()) joined += ",";
+    return name + "{" + joined + extra + "}";
+}
+
+}
+
+std::string Metrics::renderPrometheus() {
+    std::lock_guard<std::mutex> lock(familiesMutex);
+    std::ostringstream out;
+
+    for (const auto& entry : families) {
+        const std::string& name = entry.first;
+        const Family& metric = entry.second;
+        out << "# HELP " << name << " " << metric.help << "\n";
+        out << "# TYPE " << name << " " << metric.type << "\n";
+
+        if (metric.gauge) {
+            out << name << " " << metric.gauge() << "\n";
+        }
+
+        for (const auto& counter : metric.counters) {
+            out << withLabels(name, counter.first) << " " << counter.second->value() << "\n";
+        }
+
+        for (const auto& histogram : metric.histograms) {
+            const auto& bounds = histogram.second->getBounds();
+            auto counts = histogram.second->bucketCounts();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < bounds.size(); ++i) {
+                cumulative += counts[i];
+                std::ostringstream le;
+                le << "le=\"" << bounds[i] << "\"";
+                out << withLabels(name + "_bucket", histogram.first, le.str()) << " " << cumulative << "\n";
+            }
+            cumulative += counts.back();
+            out << withLabels(name + "_bucket", histogram.first, "le=\"+Inf\"") << " " << cumulative << "\n";
+            out << withLabels(name + "_sum", histogram.first) << " " << histogram.second->sum() << "\n";
+            out << withLabels(name + "_count", histogram.first) << " " << cumulative << "\n";
+        }
+    }
+
+    return out.str();
+}
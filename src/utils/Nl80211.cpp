@@ -0,0 +1,378 @@
+#include "utils/Nl80211.h"
+#include "utils/WiFiUtils.h"
+#include "utils/Logger.h"
+#include "utils/Trace.h"
+
+#ifdef MAESTRO_HAVE_LIBNL
+#include <algorithm>
+#include <thread>
+#include <poll.h>
+#include <net/if.h>
+#include <linux/nl80211.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/ctrl.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <cstdio>
+#endif
+
+Nl80211& Nl80211::getInstance() {
+    static Nl80211 instance;
+    return instance;
+}
+
+bool Nl80211::compiledIn() {
+#ifdef MAESTRO_HAVE_LIBNL
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef MAESTRO_HAVE_LIBNL
+
+namespace {
+
+struct Reply {
+    int error = 1; // positive while the request is outstanding
+    LinkStats* stats = nullptr;
+    uint32_t interfaceType = NL80211_IFTYPE_UNSPECIFIED;
+    bool gotStation = false;
+    std::vector<WiFiScanResult>* scan = nullptr;
+    int64_t maxAgeMs = 0;
+};
+
+nlattr** parseAttributes(nl_msg* msg, nlattr** attrs) {
+    auto* header = static_cast<genlmsghdr*>(nlmsg_data(nlmsg_hdr(msg)));
+    nla_parse(attrs, NL80211_ATTR_MAX, genlmsg_attrdata(header, 0), genlmsg_attrlen(header, 0), nullptr);
+    return attrs;
+}
+
+// NL80211_RATE_INFO_* nest -> Mbit/s; BITRATE32 supersedes the 16-bit field for HE/VHT rates
+double parseBitrate(nlattr* nested) {
+    nlattr* rate[NL80211_RATE_INFO_MAX + 1];
+    if (nla_parse_nested(rate, NL80211_RATE_INFO_MAX, nested, nullptr) != 0) return 0;
+    if (rate[NL80211_RATE_INFO_BITRATE32]) return nla_get_u32(rate[NL80211_RATE_INFO_BITRATE32]) / 10.0;
+    if (rate[NL80211_RATE_INFO_BITRATE]) return nla_get_u16(rate[NL80211_RATE_INFO_BITRATE]) / 10.0;
+    return 0;
+}
+
+int onInterface(nl_msg* msg, void* arg) {
+    auto* reply = static_cast<Reply*>(arg);
+    nlattr* attrs[NL80211_ATTR_MAX + 1];
+    parseAttributes(msg, attrs);
+
+    if (attrs[NL80211_ATTR_IFTYPE]) {
+        reply->interfaceType = nla_get_u32(attrs[NL80211_ATTR_IFTYPE]);
+    }
+    if (attrs[NL80211_ATTR_WIPHY_FREQ]) {
+        reply->stats->frequency = static_cast<int>(nla_get_u32(attrs[NL80211_ATTR_WIPHY_FREQ]));
+    }
+    if (attrs[NL80211_ATTR_SSID]) {
+        reply->stats->ssid.assign(static_cast<const char*>(nla_data(attrs[NL80211_ATTR_SSID])),
+                                  nla_len(attrs[NL80211_ATTR_SSID]));
+    }
+    return NL_SKIP;
+}
+
+int onStation(nl_msg* msg, void* arg) {
+    auto* reply = static_cast<Reply*>(arg);
+    // A managed interface has a single station entry, the AP; ignore anything after it
+    if (reply->gotStation) return NL_SKIP;
+
+    nlattr* attrs[NL80211_ATTR_MAX + 1];
+    parseAttributes(msg, attrs);
+    nlattr* info[NL80211_STA_INFO_MAX + 1];
+    if (!attrs[NL80211_ATTR_STA_INFO] ||
+        nla_parse_nested(info, NL80211_STA_INFO_MAX, attrs[NL80211_ATTR_STA_INFO], nullptr) != 0) {
+        return NL_SKIP;
+    }
+
+    LinkStats& stats = *reply->stats;
+    if (attrs[NL80211_ATTR_MAC]) {
+        auto* mac = static_cast<const unsigned char*>(nla_data(attrs[NL80211_ATTR_MAC]));
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        stats.bssid = bssid;
+    }
+    if (info[NL80211_STA_INFO_SIGNAL]) {
+        stats.signalDbm = static_cast<int8_t>(nla_get_u8(info[NL80211_STA_INFO_SIGNAL]));
+    }
+    if (info[NL80211_STA_INFO_SIGNAL_AVG]) {
+        stats.signalAvgDbm = static_cast<int8_t>(nla_get_u8(info[NL80211_STA_INFO_SIGNAL_AVG]));
+    }
+    if (info[NL80211_STA_INFO_TX_BITRATE]) {
+        stats.txBitrateMbps = parseBitrate(info[NL80211_STA_INFO_TX_BITRATE]);
+    }
+    if (info[NL80211_STA_INFO_RX_BITRATE]) {
+        stats.rxBitrateMbps = parseBitrate(info[NL80211_STA_INFO_RX_BITRATE]);
+    }
+    if (info[NL80211_STA_INFO_TX_RETRIES]) {
+        stats.txRetries = nla_get_u32(info[NL80211_STA_INFO_TX_RETRIES]);
+    }
+    if (info[NL80211_STA_INFO_TX_FAILED]) {
+        stats.txFailed = nla_get_u32(info[NL80211_STA_INFO_TX_FAILED]);
+    }
+    if (info[NL80211_STA_INFO_STA_FLAGS]) {
+        auto* flags = static_cast<const nl80211_sta_flag_update*>(nla_data(info[NL80211_STA_INFO_STA_FLAGS]));
+        uint32_t authorized = 1u << NL80211_STA_FLAG_AUTHORIZED;
+        stats.authorized = (flags->mask & authorized) && (flags->set & authorized);
+    }
+    reply->gotStation = true;
+    return NL_SKIP;
+}
+
+// Information elements: SSID (0) and RSN (48) or the WPA vendor element (221, 00:50:f2 type 1)
+void parseInformationElements(const unsigned char* data, int length, WiFiScanResult& result) {
+    while (length >= 2 && data[1] + 2 <= length) {
+        unsigned char id = data[0];
+        unsigned char size = data[1];
+        const unsigned char* body = data + 2;
+        if (id == 0) {
+            result.ssid.assign(reinterpret_cast<const char*>(body), size);
+        } else if (id == 48 ||
+                   (id == 221 && size >= 4 && body[0] == 0x00 && body[1] == 0x50 && body[2] == 0xf2 && body[3] == 1)) {
+            result.security = "WPA";
+        }
+        data += size + 2;
+        length -= size + 2;
+    }
+}
+
+int onBss(nl_msg* msg, void* arg) {
+    auto* reply = static_cast<Reply*>(arg);
+    nlattr* attrs[NL80211_ATTR_MAX + 1];
+    parseAttributes(msg, attrs);
+    nlattr* bss[NL80211_BSS_MAX + 1];
+    if (!attrs[NL80211_ATTR_BSS] || nla_parse_nested(bss, NL80211_BSS_MAX, attrs[NL80211_ATTR_BSS], nullptr) != 0) {
+        return NL_SKIP;
+    }
+    // The table holds everything from the last ~30 s of scans; stale signal readings would skew the average
+    if (bss[NL80211_BSS_SEEN_MS_AGO] && nla_get_u32(bss[NL80211_BSS_SEEN_MS_AGO]) > reply->maxAgeMs) {
+        return NL_SKIP;
+    }
+
+    WiFiScanResult result;
+    result.signal_strength = 0;
+    nlattr* elements = bss[NL80211_BSS_INFORMATION_ELEMENTS] ? bss[NL80211_BSS_INFORMATION_ELEMENTS]
+                                                             : bss[NL80211_BSS_BEACON_IES];
+    if (elements) {
+        parseInformationElements(static_cast<const unsigned char*>(nla_data(elements)), nla_len(elements), result);
+    }
+    if (result.ssid.empty() || result.ssid.find('\0') != std::string::npos) {
+        return NL_SKIP;
+    }
+
+    if (bss[NL80211_BSS_BSSID]) {
+        auto* mac = static_cast<const unsigned char*>(nla_data(bss[NL80211_BSS_BSSID]));
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        result.bssid = bssid;
+    }
+    if (bss[NL80211_BSS_FREQUENCY]) {
+        result.frequency = static_cast<int>(nla_get_u32(bss[NL80211_BSS_FREQUENCY]));
+    }
+    // Same dBm -> 0-100 mapping as the iw parser
+    if (bss[NL80211_BSS_SIGNAL_MBM]) {
+        int dbm = static_cast<int32_t>(nla_get_u32(bss[NL80211_BSS_SIGNAL_MBM])) / 100;
+        result.signal_strength = std::min(100, std::max(0, (dbm + 100) * 2));
+    } else if (bss[NL80211_BSS_SIGNAL_UNSPEC]) {
+        result.signal_strength = std::min<int>(100, nla_get_u8(bss[NL80211_BSS_SIGNAL_UNSPEC]));
+    }
+    reply->scan->push_back(result);
+    return NL_SKIP;
+}
+
+int onScanEvent(nl_msg* msg, void* arg) {
+    auto* header = static_cast<genlmsghdr*>(nlmsg_data(nlmsg_hdr(msg)));
+    if (header->cmd != NL80211_CMD_NEW_SCAN_RESULTS) return NL_SKIP;
+
+    nlattr* attrs[NL80211_ATTR_MAX + 1];
+    parseAttributes(msg, attrs);
+    char name[IF_NAMESIZE];
+    if (attrs[NL80211_ATTR_IFINDEX] && if_indextoname(nla_get_u32(attrs[NL80211_ATTR_IFINDEX]), name)) {
+        (*static_cast<std::function<void(const std::string&)>*>(arg))(name);
+    }
+    return NL_SKIP;
+}
+
+int onError(sockaddr_nl*, nlmsgerr* err, void* arg) {
+    static_cast<Reply*>(arg)->error = err->error;
+    return NL_STOP;
+}
+
+int onFinish(nl_msg*, void* arg) {
+    static_cast<Reply*>(arg)->error = 0;
+    return NL_SKIP;
+}
+
+int onAck(nl_msg*, void* arg) {
+    static_cast<Reply*>(arg)->error = 0;
+    return NL_STOP;
+}
+
+// Sends one nl80211 command for ifindex and runs handler on every reply until done or error
+int transact(nl_sock* sock, int familyId, int flags, uint8_t command, unsigned int ifindex,
+             nl_recvmsg_msg_cb_t handler, Reply& reply) {
+    nl_msg* msg = nlmsg_alloc();
+    nl_cb* cb = nl_cb_alloc(NL_CB_DEFAULT);
+    if (!msg || !cb) {
+        nlmsg_free(msg);
+        nl_cb_put(cb);
+        return -NLE_NOMEM;
+    }
+
+    genlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, familyId, 0, flags, command, 0);
+    nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifindex);
+
+    nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, handler, &reply);
+    nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, onFinish, &reply);
+    nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, onAck, &reply);
+    nl_cb_err(cb, NL_CB_CUSTOM, onError, &reply);
+
+    reply.error = 1;
+    int result = nl_send_auto(sock, msg);
+    while (result >= 0 && reply.error > 0) {
+        result = nl_recvmsgs(sock, cb);
+    }
+
+    nlmsg_free(msg);
+    nl_cb_put(cb);
+    return result < 0 ? result : reply.error;
+}
+
+} // namespace
+
+Nl80211::~Nl80211() {
+    monitoring = false;
+    closeSocket();
+}
+
+bool Nl80211::ensureSocket() {
+    if (sock) return true;
+
+    sock = nl_socket_alloc();
+    if (!sock) return false;
+    if (genl_connect(sock) != 0 || (familyId = genl_ctrl_resolve(sock, "nl80211")) < 0) {
+        Logger::getInstance().warning("nl80211 unavailable, falling back to iw for link statistics");
+        closeSocket();
+        return false;
+    }
+    return true;
+}
+
+void Nl80211::closeSocket() {
+    if (sock) {
+        nl_socket_free(sock);
+        sock = nullptr;
+    }
+    familyId = -1;
+}
+
+bool Nl80211::getLinkStats(const std::string& interface, LinkStats& stats) {
+    unsigned int ifindex = if_nametoindex(interface.c_str());
+    if (ifindex == 0) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ensureSocket()) return false;
+
+    stats = LinkStats();
+    Reply reply;
+    reply.stats = &stats;
+    if (transact(sock, familyId, 0, NL80211_CMD_GET_INTERFACE, ifindex, onInterface, reply) != 0) {
+        // The socket may be out of sync after a failed exchange; start clean next time
+        closeSocket();
+        return false;
+    }
+    // Only a station interface has a link; on the hotspot the station dump lists the phones
+    if (reply.interfaceType != NL80211_IFTYPE_STATION) {
+        stats = LinkStats();
+        return true;
+    }
+    if (transact(sock, familyId, NLM_F_DUMP, NL80211_CMD_GET_STATION, ifindex, onStation, reply) != 0) {
+        closeSocket();
+        return false;
+    }
+
+    stats.associated = reply.gotStation;
+    return true;
+}
+
+bool Nl80211::dumpScan(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results) {
+    MAESTRO_TRACE_SPAN("nl80211", "dumpScan");
+    unsigned int ifindex = if_nametoindex(interface.c_str());
+    if (ifindex == 0) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ensureSocket()) return false;
+
+    results.clear();
+    Reply reply;
+    reply.scan = &results;
+    reply.maxAgeMs = maxAgeMs;
+    if (transact(sock, familyId, NLM_F_DUMP, NL80211_CMD_GET_SCAN, ifindex, onBss, reply) != 0) {
+        closeSocket();
+        return false;
+    }
+    return true;
+}
+
+bool Nl80211::startScanMonitor(std::function<void(const std::string&)> onResults) {
+    if (monitoring.exchange(true)) return true;
+
+    // Events get a socket of their own; replies to queries on the request socket never interleave with them
+    nl_sock* events = nl_socket_alloc();
+    int group = -1;
+    if (!events || genl_connect(events) != 0 || (group = genl_ctrl_resolve_grp(events, "nl80211", "scan")) < 0 ||
+        nl_socket_add_membership(events, group) != 0) {
+        if (events) nl_socket_free(events);
+        monitoring = false;
+        return false;
+    }
+    nl_socket_disable_seq_check(events);
+
+    scanHandler = std::move(onResults);
+    nl_socket_modify_cb(events, NL_CB_VALID, NL_CB_CUSTOM, onScanEvent, &scanHandler);
+    std::thread(&Nl80211::scanMonitorLoop, this, events).detach();
+    return true;
+}
+
+void Nl80211::scanMonitorLoop(nl_sock* events) {
+    Trace::getInstance().setThreadName("nl80211-scan");
+
+    while (monitoring) {
+        pollfd pending{nl_socket_get_fd(events), POLLIN, 0};
+        if (poll(&pending, 1, 1000) <= 0) continue;
+        // A burst of events can overrun the socket buffer; the next one still brings the full table
+        nl_recvmsgs_default(events);
+    }
+    nl_socket_free(events);
+}
+
+#else
+
+Nl80211::~Nl80211() = default;
+
+bool Nl80211::ensureSocket() {
+    return false;
+}
+
+void Nl80211::closeSocket() {
+}
+
+bool Nl80211::getLinkStats(const std::string&, LinkStats&) {
+    return false;
+}
+
+bool Nl80211::dumpScan(const std::string&, int64_t, std::vector<WiFiScanResult>&) {
+    return false;
+}
+
+bool Nl80211::startScanMonitor(std::function<void(const std::string&)>) {
+    return false;
+}
+
+void Nl80211::scanMonitorLoop(nl_sock*) {
+}
+
+#endif
@@ -0,0 +1,444 @@
+#include "utils/SimulatedBackend.h"
+#include "utils/ConfigManager.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <thread>
+
+SimulatedBackend::Options SimulatedBackend::Options::fromConfig() {
+    auto& config = ConfigManager::getInstance();
+    Options options;
+    options.scanNetworks = std::stoi(config.get("SIM_SCAN_NETWORKS", "20"));
+    options.scanLatencyMs = std::stoi(config.get("SIM_SCAN_LATENCY_MS", "1500"));
+    options.associationLatencyMs = std::stoi(config.get("SIM_ASSOCIATION_LATENCY_MS", "3000"));
+    options.dhcpLatencyMs = std::stoi(config.get("SIM_DHCP_LATENCY_MS", "1000"));
+    options.serviceLatencyMs = std::stoi(config.get("SIM_SERVICE_LATENCY_MS", "200"));
+    options.dockerLatencyMs = std::stoi(config.get("SIM_DOCKER_LATENCY_MS", "2000"));
+    options.dockerPullLatencyMs = std::stoi(config.get("SIM_DOCKER_PULL_LATENCY_MS", "10000"));
+    options.scanFailureRate = std::stod(config.get("SIM_SCAN_FAILURE_RATE", "0"));
+    options.connectFailureRate = std::stod(config.get("SIM_CONNECT_FAILURE_RATE", "0"));
+    options.apForceSupported = config.get("SIM_AP_FORCE_SUPPORTED", "true") == "true";
+    options.apStations = std::stoi(config.get("SIM_AP_STATIONS", "0"));
+    options.apStationInactiveMs = std::stoi(config.get("SIM_AP_STATION_INACTIVE_MS", "1000"));
+    options.apInterface = config.get("NETWORK_INTERFACE", "wlan0");
+    return options;
+}
+
+SimulatedBackend::SimulatedBackend(const Options& options) : options(options), random(std::random_device{}()) {
+    for (int channel = 1; channel <= 11; ++channel) {
+        channels.push_back(2407 + channel * 5);
+    }
+    for (int channel : {36, 40, 44, 48, 149, 153, 157, 161}) {
+        channels.push_back(5000 + channel * 5);
+    }
+
+    for (int i = 0; i < options.scanNetworks; ++i) {
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), "02:5e:00:00:%02x:%02x", (i >> 8) & 0xff, i & 0xff);
+        SimulatedBss bss;
+        bss.bssid = bssid;
+        bss.ssid = "SimNet-" + std::to_string(i);
+        bss.frequency = channels[i % channels.size()];
+        bss.signalDbm = -35 - (i * 7) % 55;
+        bss.secured = (i % 5) != 0;
+        environment.push_back(bss);
+    }
+}
+
+int SimulatedBackend::run(const std::string& command) {
+    std::string output;
+    int code = execute(command, output);
+    return code << 8; // system() wait status
+}
+
+std::string SimulatedBackend::capture(const std::string& command, int* exitStatus) {
+    std::string output;
+    int code = execute(command, output);
+    if (exitStatus) *exitStatus = code;
+    return output;
+}
+
+bool SimulatedBackend::roll(double failureRate) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(random) < failureRate;
+}
+
+bool SimulatedBackend::isAssociated() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return !associatedSsid.empty() && associationWillSucceed && std::chrono::steady_clock::now() >= associatedAt;
+}
+
+// State reported while an association is still in flight; the last 300 ms before it completes is the handshake
+std::string SimulatedBackend::pendingWpaState() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (associatedSsid.empty() || now >= associatedAt) return associatedSsid.empty() ? "INACTIVE" : "SCANNING";
+    if (associationWillSucceed && now >= associatedAt - std::chrono::milliseconds(300)) return "4WAY_HANDSHAKE";
+    return "ASSOCIATING";
+}
+
+void SimulatedBackend::sleepMs(int ms) {
+    if (ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+int SimulatedBackend::execute(const std::string& command, std::string& output) {
+    if (command.find("systemctl ") == 0) {
+        sleepMs(options.serviceLatencyMs);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (command.find("hostapd") != std::string::npos || command.find("hotspot") != std::string::npos) {
+            if (command.find("systemctl stop") == 0) hotspotUp = false;
+            if (command.find("systemctl start") == 0) hotspotUp = true;
+        }
+        return 0;
+    }
+    if (command.find("ip -4 ") == 0 && command.find(" addr show") != std::string::npos) {
+        bool leased = isAssociated();
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (leased && std::chrono::steady_clock::now() >= leaseAt) {
+            output = "3: " + options.apInterface + "    inet 10.42.0.23/24 brd 10.42.0.255 scope global dynamic\n";
+        }
+        return 0;
+    }
+    if (command.find("dhclient ") == 0) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        leaseAt = std::max(associatedAt, std::chrono::steady_clock::now()) +
+                  std::chrono::milliseconds(options.dhcpLatencyMs);
+        return 0;
+    }
+    if (command.find("nmcli connection down") == 0) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        associatedSsid.clear();
+        return 0;
+    }
+    if (command.find("ping ") == 0 || command.find("curl ") == 0) {
+        sleepMs(50);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        bool online = !associatedSsid.empty() && associationWillSucceed && std::chrono::steady_clock::now() >= leaseAt;
+        return online ? 0 : 1;
+    }
+    if (command.find("docker-compose") != std::string::npos) {
+        return dockerCompose(command);
+    }
+
+    // ip link/addr and anything else succeed instantly
+    return 0;
+}
+
+// Only the primary interface hosts the AP; names sharing its prefix are virtual interfaces on its phy,
+// any other name is an idle secondary radio on a phy of its own
+bool SimulatedBackend::interfaceInfo(const std::string& interface, WirelessInterface& info) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    bool samePhy = interface.compare(0, options.apInterface.size(), options.apInterface) == 0;
+    if (samePhy && interface != options.apInterface && scanInterfaces.count(interface) == 0) return false;
+
+    bool hostingAp = hotspotUp && interface == options.apInterface;
+    info = WirelessInterface();
+    info.wiphy = samePhy ? 0 : 1;
+    info.type = hostingAp ? "AP" : "managed";
+    if (hostingAp) info.frequency = 2437;
+    return true;
+}
+
+std::vector<int> SimulatedBackend::phyFrequencies(int wiphy) {
+    return wiphy >= 0 ? channels : std::vector<int>();
+}
+
+bool SimulatedBackend::addScanInterface(const std::string& parent, const std::string& name, bool& created) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    created = parent == options.apInterface && scanInterfaces.insert(name).second;
+    return scanInterfaces.count(name) > 0;
+}
+
+void SimulatedBackend::removeInterface(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    scanInterfaces.erase(name);
+}
+
+bool SimulatedBackend::scan(const std::string& interface, const std::vector<int>& requested, bool apForce,
+                            std::vector<WiFiScanResult>& results) {
+    bool onApInterface = interface == options.apInterface;
+    bool onVirtualInterface;
+    bool hotspot;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        onVirtualInterface = scanInterfaces.count(interface) > 0;
+        hotspot = hotspotUp;
+    }
+
+    // A beaconing AP interface refuses scans unless the driver honours ap-force
+    if (hotspot && onApInterface && (!apForce || !options.apForceSupported)) {
+        return false;
+    }
+    if (roll(options.scanFailureRate)) {
+        return false;
+    }
+
+    // The virtual interface shares the AP's channel while the hotspot is up
+    std::vector<int> frequencies = requested;
+    if (hotspot && onVirtualInterface) {
+        frequencies = {2437};
+    }
+    size_t scannedChannels = frequencies.empty() ? channels.size() : frequencies.size();
+    sleepMs(std::max(50, static_cast<int>(options.scanLatencyMs * scannedChannels / channels.size())));
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    results.clear();
+    for (const auto& bss : environment) {
+        if (!frequencies.empty() &&
+            std::find(frequencies.begin(), frequencies.end(), bss.frequency) == frequencies.end()) {
+            continue;
+        }
+
+        int signal = bss.signalDbm + std::uniform_int_distribution<int>(-3, 3)(random);
+        WiFiScanResult result;
+        result.ssid = bss.ssid;
+        result.signal_strength = std::min(100, std::max(0, (signal + 100) * 2));
+        result.security = bss.secured ? "WPA" : "";
+        result.bssid = bss.bssid;
+        result.frequency = bss.frequency;
+        results.push_back(result);
+    }
+    return true;
+}
+
+// The BSS we're associated with, as nl80211 station info would describe it
+bool SimulatedBackend::linkStats(const std::string& interface, LinkStats& stats) {
+    bool associated = isAssociated();
+    std::lock_guard<std::mutex> lock(stateMutex);
+    stats = LinkStats();
+    auto bss = std::find_if(environment.begin(), environment.end(),
+                            [this](const SimulatedBss& candidate) { return candidate.ssid == associatedSsid; });
+    if (interface != options.apInterface || !associated || bss == environment.end()) {
+        return true;
+    }
+
+    stats.associated = true;
+    stats.authorized = true;
+    stats.ssid = bss->ssid;
+    stats.bssid = bss->bssid;
+    stats.frequency = bss->frequency;
+    stats.signalDbm = bss->signalDbm + std::uniform_int_distribution<int>(-3, 3)(random);
+    stats.signalAvgDbm = bss->signalDbm;
+    stats.txBitrateMbps = 72.2;
+    stats.rxBitrateMbps = 65.0;
+    stats.txRetries = static_cast<uint32_t>(std::uniform_int_distribution<int>(0, 40)(random));
+    return true;
+}
+
+bool SimulatedBackend::dumpScanResults(const std::string&, int64_t, std::vector<WiFiScanResult>&) {
+    return false;
+}
+
+bool SimulatedBackend::startScanMonitor(std::function<void(const std::string&)>) {
+    return false;
+}
+
+bool SimulatedBackend::wpaStatus(const std::string&, std::map<std::string, std::string>& status) {
+    bool associated = isAssociated();
+    std::string state = associated ? "COMPLETED" : pendingWpaState();
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    status.clear();
+    status["wpa_state"] = state;
+    if (!associated) return true;
+
+    status["ssid"] = associatedSsid;
+    for (const auto& bss : environment) {
+        if (bss.ssid == associatedSsid) {
+            status["bssid"] = bss.bssid;
+            status["freq"] = std::to_string(bss.frequency);
+            break;
+        }
+    }
+    return true;
+}
+
+bool SimulatedBackend::wpaListNetworks(const std::string&, std::vector<WpaNetwork>& list) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    list.clear();
+    for (const auto& network : networks) {
+        auto ssid = network.second.fields.find("ssid");
+        WpaNetwork entry;
+        entry.id = network.first;
+        entry.ssid = ssid == network.second.fields.end() ? std::string() : ssidValue(ssid->second);
+        entry.disabled = network.second.disabled;
+        list.push_back(entry);
+    }
+    return true;
+}
+
+int SimulatedBackend::wpaAddNetwork(const std::string&) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    int id = nextNetworkId++;
+    networks[id] = SimulatedNetwork();
+    return id;
+}
+
+std::string SimulatedBackend::ssidValue(const std::string& value) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        return value.substr(1, value.size() - 2);
+    }
+    if (value.size() % 2 != 0 ||
+        !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isxdigit(c); })) {
+        return "";
+    }
+    std::string ssid;
+    for (size_t i = 0; i < value.size(); i += 2) {
+        ssid += static_cast<char>(std::stoi(value.substr(i, 2), nullptr, 16));
+    }
+    return ssid;
+}
+
+bool SimulatedBackend::wpaSetNetwork(const std::string&, int id, const std::string& field, const std::string& value) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto network = networks.find(id);
+    if (network == networks.end()) return false;
+    if (field == "ssid" && ssidValue(value).empty()) return false;
+
+    // "any" and an empty value unset a field, as wpa_supplicant treats them
+    if (value.empty() || (field == "bssid" && value == "any")) {
+        network->second.fields.erase(field);
+    } else {
+        network->second.fields[field] = value;
+    }
+    if (field == "scan_freq") {
+        pinnedChannel = !value.empty() && value != "0";
+    }
+    return true;
+}
+
+bool SimulatedBackend::wpaGetNetwork(const std::string&, int id, const std::string& field, std::string& value) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto network = networks.find(id);
+    if (network == networks.end()) return false;
+    auto set = network->second.fields.find(field);
+    if (set == network->second.fields.end()) return false;
+    value = set->second;
+    return true;
+}
+
+void SimulatedBackend::associate(const SimulatedNetwork& network, bool fails) {
+    auto ssid = network.fields.find("ssid");
+    if (ssid == network.fields.end()) return;
+
+    // With the channel pinned the supplicant skips its own sweep, which is most of the association time
+    int latencyMs = pinnedChannel ? options.associationLatencyMs / 4 : options.associationLatencyMs;
+    associatedSsid = ssidValue(ssid->second);
+    associationWillSucceed = !fails;
+    associatedAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(latencyMs);
+    leaseAt = std::chrono::steady_clock::time_point::max();
+}
+
+bool SimulatedBackend::wpaNetwork(const std::string&, WpaNetworkAction action, int id) {
+    bool connecting = id >= 0 && (action == WpaNetworkAction::Enable || action == WpaNetworkAction::Select);
+    bool fails = connecting && roll(options.connectFailureRate);
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto target = networks.find(id);
+    if (id >= 0 && target == networks.end()) return false;
+    if (id < 0 && (action == WpaNetworkAction::Select || action == WpaNetworkAction::Remove)) return false;
+
+    auto isAssociatedWith = [this](const SimulatedNetwork& network) {
+        auto ssid = network.fields.find("ssid");
+        return ssid != network.fields.end() && !associatedSsid.empty() && ssidValue(ssid->second) == associatedSsid;
+    };
+
+    switch (action) {
+        case WpaNetworkAction::Enable:
+        case WpaNetworkAction::Disable: {
+            bool disable = action == WpaNetworkAction::Disable;
+            for (auto& network : networks) {
+                if (id >= 0 && network.first != id) continue;
+                network.second.disabled = disable;
+                if (disable && isAssociatedWith(network.second)) associatedSsid.clear();
+            }
+            if (connecting && !disconnected) associate(target->second, fails);
+            return true;
+        }
+        case WpaNetworkAction::Select:
+            disconnected = false;
+            for (auto& network : networks) {
+                network.second.disabled = network.first != id;
+            }
+            associate(target->second, fails);
+            return true;
+        case WpaNetworkAction::Remove:
+            if (isAssociatedWith(target->second)) associatedSsid.clear();
+            networks.erase(target);
+            return true;
+    }
+    return false;
+}
+
+bool SimulatedBackend::wpaDisconnect(const std::string&) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    associatedSsid.clear();
+    disconnected = true;
+    return true;
+}
+
+bool SimulatedBackend::wpaReconnect(const std::string&) {
+    bool fails = roll(options.connectFailureRate);
+    std::lock_guard<std::mutex> lock(stateMutex);
+    disconnected = false;
+    if (!associatedSsid.empty()) return true;
+    for (const auto& network : networks) {
+        if (!network.second.disabled) {
+            associate(network.second, fails);
+            break;
+        }
+    }
+    return true;
+}
+
+bool SimulatedBackend::wpaSaveConfig(const std::string&) {
+    return true;
+}
+
+bool SimulatedBackend::apStations(std::vector<ApStation>& stations) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (!hotspotUp) return false;
+    stations.clear();
+    for (int i = 0; i < options.apStations; ++i) {
+        char mac[18];
+        snprintf(mac, sizeof(mac), "02:53:00:00:%02x:%02x", (i >> 8) & 0xff, i & 0xff);
+        ApStation station;
+        station.mac = mac;
+        station.inactiveMs = options.apStationInactiveMs;
+        station.connectedSeconds = 60;
+        stations.push_back(station);
+    }
+    return true;
+}
+
+bool SimulatedBackend::startApEventMonitor(std::function<void(const std::string&, const std::string&)>) {
+    return false;
+}
+
+// Pull, create and start are separate costs so a prepared container starts quickly
+int SimulatedBackend::dockerCompose(const std::string& command) {
+    bool pulled;
+    bool created;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (command.find(" ps ") != std::string::npos) return containerRunning ? 0 : 1;
+        pulled = imagePulled;
+        created = containerCreated;
+    }
+
+    bool pull = command.find(" pull ") != std::string::npos;
+    bool up = command.find(" up ") != std::string::npos;
+    bool noStart = command.find("--no-start") != std::string::npos;
+    if (pull || (up && !pulled)) sleepMs(options.dockerPullLatencyMs);
+    if (up && !created) sleepMs(options.dockerLatencyMs / 2);
+    if ((up && !noStart) || command.find(" stop ") != std::string::npos) sleepMs(options.dockerLatencyMs / 2);
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (pull || up) imagePulled = true;
+    if (up) containerCreated = true;
+    if (up && !noStart) containerRunning = true;
+    if (command.find(" stop ") != std::string::npos) containerRunning = false;
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "utils/StartupTimeline.h"
+#include "utils/Logger.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <ctime>
+#include <unistd.h>
+
+StartupTimeline& StartupTimeline::getInstance() {
+    static StartupTimeline instance;
+    return instance;
+}
+
+StartupTimeline::StartupTimeline() : origin(std::chrono::steady_clock::now()) {
+    // Rebase onto the kernel's process start time so loader and static init are included
+    std::ifstream stat("/proc/self/stat");
+    std::string content;
+    std::getline(stat, content);
+    size_t comm_end = content.rfind(')');
+    if (comm_end == std::string::npos) return;
+
+    // starttime is field 22; fields after the command name start at field 3
+    std::istringstream fields(content.substr(comm_end + 2));
+    std::string field;
+    unsigned long long startTicks = 0;
+    for (int i = 3; i <= 22 && fields >> field; ++i) {
+        if (i == 22) startTicks = std::stoull(field);
+    }
+
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    struct timespec boot;
+    if (startTicks == 0 || ticksPerSecond <= 0 || clock_gettime(CLOCK_BOOTTIME, &boot) != 0) return;
+
+    double sinceBootMs = boot.tv_sec * 1000.0 + boot.tv_nsec / 1e6;
+    double startedMs = startTicks * 1000.0 / ticksPerSecond;
+    if (sinceBootMs > startedMs) {
+        origin -= std::chrono::microseconds(static_cast<long long>((sinceBootMs - startedMs) * 1000.0));
+    }
+}
+
+void StartupTimeline::mark(const std::string& phase) {
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.push_back({phase, elapsedMs});
+    }
+
+    std::ostringstream message;
+    message << "Startup phase '" << phase << "' reached at " << std::fixed << std::setprecision(1) << elapsedMs << " ms";
+    Logger::getInstance().info(message.str());
+}
+
+void StartupTimeline::markOnce(std::atomic<bool>& flag, const std::string& phase) {
+    if (flag.load(std::memory_order_relaxed)) return;
+    if (!flag.exchange(true)) {
+        mark(phase);
+    }
+}
+
+std::vector<TimelineEvent> StartupTimeline::getEvents() {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    return events;
+}
@@ -0,0 +1,50 @@
+#include "utils/Subprocess.h"
+#include "utils/SystemBackend.h"
+#include "utils/Metrics.h"
+#include "utils/Trace.h"
+#include <cctype>
+
+namespace {
+
+// "cd /opt/maestro && docker-compose up -d" counts as docker-compose, and so does the same command
+// run under "nice -n 19 ionice -c 3"
+std::string toolName(const std::string& command) {
+    size_t start = command.rfind("&& ");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    while (true) {
+        size_t end = command.find(' ', start);
+        std::string word = command.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        bool wrapper = word == "nice" || word == "ionice" || (!word.empty() && word[0] == '-') ||
+                       (!word.empty() && std::isdigit(static_cast<unsigned char>(word[0])));
+        if (!wrapper || end == std::string::npos) return word;
+        start = end + 1;
+    }
+}
+
+void countSpawn(const std::string& command, bool failed) {
+    auto& metrics = Metrics::getInstance();
+    std::string labels = "tool=\"" + toolName(command) + "\"";
+    metrics.counter("maestro_subprocess_spawned_total", "External commands spawned", labels).inc();
+    if (failed) {
+        metrics.counter("maestro_subprocess_failed_total", "External commands that exited non-zero", labels).inc();
+    }
+}
+
+}
+
+int Subprocess::run(const std::string& command) {
+    // Only the tool name goes into the trace; command lines can carry keys
+    TraceSpan span("subprocess", "run", Trace::enabled() ? toolName(command) : std::string());
+    int status = SystemBackend::get().run(command);
+    countSpawn(command, status != 0);
+    return status;
+}
+
+std::string Subprocess::capture(const std::string& command, int* exitStatus) {
+    TraceSpan span("subprocess", "capture", Trace::enabled() ? toolName(command) : std::string());
+    int code = 0;
+    std::string output = SystemBackend::get().capture(command, &code);
+    countSpawn(command, code != 0);
+    if (exitStatus) *exitStatus = code;
+    return output;
+}
@@ -0,0 +1,283 @@
+#include "utils/SystemBackend.h"
+#include "utils/SimulatedBackend.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/Nl80211.h"
+#include "utils/Subprocess.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <sys/wait.h>
+
+namespace {
+
+std::unique_ptr<SystemBackend>& installedBackend() {
+    static std::unique_ptr<SystemBackend> backend = std::make_unique<ShellBackend>();
+    return backend;
+}
+
+// Single-quoted for the shell, so "\"my net\"" reaches wpa_cli as one argument with its quotes
+std::string shellQuote(const std::string& value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+std::string trimNewline(std::string text) {
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    return text;
+}
+
+}
+
+SystemBackend& SystemBackend::get() {
+    return *installedBackend();
+}
+
+void SystemBackend::install(std::unique_ptr<SystemBackend> backend) {
+    installedBackend() = std::move(backend);
+}
+
+void SystemBackend::installFromConfig() {
+    auto& config = ConfigManager::getInstance();
+    std::string name = config.get("SYSTEM_BACKEND", "shell");
+    if (name == "simulated") {
+        Logger::getInstance().warning("Using simulated system backend; no radio or services will be touched");
+        install(std::make_unique<SimulatedBackend>(SimulatedBackend::Options::fromConfig()));
+    } else {
+        install(std::make_unique<ShellBackend>());
+    }
+}
+
+int ShellBackend::run(const std::string& command) {
+    return system(command.c_str());
+}
+
+std::string ShellBackend::capture(const std::string& command, int* exitStatus) {
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) {
+        if (exitStatus) *exitStatus = -1;
+        return output;
+    }
+
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        output += buffer;
+    }
+
+    int status = pclose(pipe);
+    if (exitStatus) {
+        *exitStatus = (status != -1 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+    }
+    return output;
+}
+
+bool ShellBackend::interfaceInfo(const std::string& interface, WirelessInterface& info) {
+    int status = 0;
+    std::istringstream stream(Subprocess::capture("iw dev " + interface + " info 2>/dev/null", &status));
+    if (status != 0) return false;
+
+    info = WirelessInterface();
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t indent = line.find_first_not_of(" \t");
+        if (indent == std::string::npos) continue;
+        line.erase(0, indent);
+
+        if (line.compare(0, 6, "wiphy ") == 0) {
+            info.wiphy = std::atoi(line.c_str() + 6);
+        } else if (line.compare(0, 5, "type ") == 0) {
+            info.type = line.substr(5);
+        } else if (line.compare(0, 8, "channel ") == 0) {
+            // "channel 6 (2437 MHz), width: 20 MHz, ..." is only present while the interface is operating
+            size_t paren = line.find('(');
+            if (paren != std::string::npos) info.frequency = std::atoi(line.c_str() + paren + 1);
+        }
+    }
+    return true;
+}
+
+std::vector<int> ShellBackend::phyFrequencies(int wiphy) {
+    std::vector<int> frequencies;
+    std::istringstream stream(Subprocess::capture("iw phy phy" + std::to_string(wiphy) + " info 2>/dev/null"));
+    std::string line;
+    while (std::getline(stream, line)) {
+        // Frequency lines look like "* 2412 MHz [1] (20.0 dBm)"
+        size_t star = line.find("* ");
+        if (star == std::string::npos || line.find(" MHz [") == std::string::npos) continue;
+        if (line.find("disabled") != std::string::npos) continue;
+
+        int frequency = std::atoi(line.c_str() + star + 2);
+        if (frequency > 0) {
+            frequencies.push_back(frequency);
+        }
+    }
+    return frequencies;
+}
+
+bool ShellBackend::addScanInterface(const std::string& parent, const std::string& name, bool& created) {
+    created = false;
+    if (Subprocess::run("ip link show " + name + " >/dev/null 2>&1") != 0) {
+        if (Subprocess::run("iw dev " + parent + " interface add " + name + " type managed") != 0) return false;
+        created = true;
+    }
+    return Subprocess::run("ip link set " + name + " up") == 0;
+}
+
+void ShellBackend::removeInterface(const std::string& name) {
+    Subprocess::run("iw dev " + name + " del 2>/dev/null");
+}
+
+bool ShellBackend::scan(const std::string& interface, const std::vector<int>& frequencies, bool apForce,
+                        std::vector<WiFiScanResult>& results) {
+    // iw passes the list to nl80211 as NL80211_ATTR_SCAN_FREQUENCIES; an empty list scans everything
+    std::string command = "iw dev " + interface + " scan";
+    if (!frequencies.empty()) {
+        command += " freq";
+        for (int frequency : frequencies) {
+            command += " " + std::to_string(frequency);
+        }
+    }
+    if (apForce) {
+        command += " ap-force";
+    }
+    command += " 2>/dev/null";
+
+    int status = 0;
+    std::string output = Subprocess::capture(command, &status);
+    if (status != 0) return false;
+    results = WiFiUtils::parseScanOutput(output);
+    return true;
+}
+
+bool ShellBackend::linkStats(const std::string& interface, LinkStats& stats) {
+    auto& metrics = Metrics::getInstance();
+    if (Nl80211::getInstance().getLinkStats(interface, stats)) {
+        metrics.counter("maestro_link_stats_total", "Link statistics reads by source", "source=\"nl80211\"").inc();
+        return true;
+    }
+
+    metrics.counter("maestro_link_stats_total", "Link statistics reads by source", "source=\"iw\"").inc();
+    int status = 0;
+    std::string output = Subprocess::capture("iw dev " + interface + " link 2>/dev/null; iw dev " + interface +
+                                             " station dump 2>/dev/null", &status);
+    stats = WiFiUtils::parseLinkOutput(output);
+    return status == 0;
+}
+
+bool ShellBackend::dumpScanResults(const std::string& interface, int64_t maxAgeMs, std::vector<WiFiScanResult>& results) {
+    return Nl80211::getInstance().dumpScan(interface, maxAgeMs, results);
+}
+
+bool ShellBackend::startScanMonitor(std::function<void(const std::string&)> onResults) {
+    return Nl80211::getInstance().startScanMonitor(std::move(onResults));
+}
+
+bool ShellBackend::wpaCli(const std::string& interface, const std::string& arguments, std::string* output) {
+    int status = 0;
+    std::string reply = Subprocess::capture("wpa_cli -i " + interface + " " + arguments + " 2>/dev/null", &status);
+    bool ok = status == 0 && reply.compare(0, 4, "FAIL") != 0;
+    if (output) *output = reply;
+    return ok;
+}
+
+bool ShellBackend::wpaStatus(const std::string& interface, std::map<std::string, std::string>& status) {
+    std::string output;
+    if (!wpaCli(interface, "status", &output)) return false;
+
+    status.clear();
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            status[line.substr(0, equals)] = trimNewline(line.substr(equals + 1));
+        }
+    }
+    auto ssid = status.find("ssid");
+    if (ssid != status.end()) ssid->second = WiFiUtils::unescapeSsid(ssid->second);
+    return true;
+}
+
+std::vector<WpaNetwork> ShellBackend::parseListNetworks(const std::string& output) {
+    std::vector<WpaNetwork> networks;
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos || !std::isdigit(static_cast<unsigned char>(line[0]))) continue;
+        size_t end = line.find('\t', tab + 1);
+
+        WpaNetwork network;
+        network.id = std::atoi(line.c_str());
+        network.ssid = WiFiUtils::unescapeSsid(line.substr(tab + 1, end == std::string::npos ? std::string::npos : end - tab - 1));
+        network.disabled = line.find("[DISABLED]", end == std::string::npos ? tab : end) != std::string::npos;
+        networks.push_back(network);
+    }
+    return networks;
+}
+
+bool ShellBackend::wpaListNetworks(const std::string& interface, std::vector<WpaNetwork>& networks) {
+    std::string output;
+    if (!wpaCli(interface, "list_networks", &output)) return false;
+    networks = parseListNetworks(output);
+    return true;
+}
+
+int ShellBackend::wpaAddNetwork(const std::string& interface) {
+    std::string output;
+    if (!wpaCli(interface, "add_network", &output) || output.empty() ||
+        !std::isdigit(static_cast<unsigned char>(output[0]))) {
+        return -1;
+    }
+    return std::atoi(output.c_str());
+}
+
+bool ShellBackend::wpaSetNetwork(const std::string& interface, int id, const std::string& field, const std::string& value) {
+    return wpaCli(interface, "set_network " + std::to_string(id) + " " + field + " " + shellQuote(value));
+}
+
+bool ShellBackend::wpaGetNetwork(const std::string& interface, int id, const std::string& field, std::string& value) {
+    std::string output;
+    if (!wpaCli(interface, "get_network " + std::to_string(id) + " " + field, &output)) return false;
+    value = trimNewline(output);
+    return true;
+}
+
+bool ShellBackend::wpaNetwork(const std::string& interface, WpaNetworkAction action, int id) {
+    std::string target = id < 0 ? "all" : std::to_string(id);
+    switch (action) {
+        case WpaNetworkAction::Enable: return wpaCli(interface, "enable_network " + target);
+        case WpaNetworkAction::Disable: return wpaCli(interface, "disable_network " + target);
+        case WpaNetworkAction::Select: return id >= 0 && wpaCli(interface, "select_network " + target);
+        case WpaNetworkAction::Remove: return id >= 0 && wpaCli(interface, "remove_network " + target);
+    }
+    return false;
+}
+
+bool ShellBackend::wpaDisconnect(const std::string& interface) {
+    return wpaCli(interface, "disconnect");
+}
+
+bool ShellBackend::wpaReconnect(const std::string& interface) {
+    return wpaCli(interface, "reconnect");
+}
+
+bool ShellBackend::wpaSaveConfig(const std::string& interface) {
+    return wpaCli(interface, "save_config");
+}
+
+bool ShellBackend::apStations(std::vector<ApStation>& stations) {
+    return HostapdControl::getInstance().listStations(stations);
+}
+
+bool ShellBackend::startApEventMonitor(std::function<void(const std::string&, const std::string&)> onEvent) {
+    HostapdControl::getInstance().startEventMonitor(std::move(onEvent));
+    return true;
+}
@@ -0,0 +1,63 @@
+#include "utils/Systemd.h"
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kListenFdsStart = 3;
+
+}
+
+std::vector<int> Systemd::listenFds() {
+    std::vector<int> fds;
+    const char* pid = getenv("LISTEN_PID");
+    const char* count = getenv("LISTEN_FDS");
+
+    // The variables are meant for one process; a child that inherited them must ignore them
+    if (pid && count && std::strtol(pid, nullptr, 10) == getpid()) {
+        int n = std::atoi(count);
+        for (int fd = kListenFdsStart; fd < kListenFdsStart + n; ++fd) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fds.push_back(fd);
+        }
+    }
+
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+    return fds;
+}
+
+bool Systemd::notify(const std::string& state) {
+    const char* path = getenv("NOTIFY_SOCKET");
+    if (!path || (path[0] != '/' && path[0] != '@')) return false;
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    size_t length = std::strlen(path);
+    if (length >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path, length);
+    if (address.sun_path[0] == '@') address.sun_path[0] = '\0'; // abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    ssize_t sent = sendto(fd, state.data(), state.size(), MSG_NOSIGNAL, reinterpret_cast<sockaddr*>(&address),
+                          static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + length));
+    close(fd);
+    return sent == static_cast<ssize_t>(state.size());
+}
+
+int Systemd::boundPort(int fd) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return 0;
+    if (address.ss_family == AF_INET) return ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port);
+    return 0;
+}
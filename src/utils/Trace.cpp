@@ -0,0 +1,151 @@
+#include "utils/Trace.h"
+#include "utils/ConfigManager.h"
+#include "utils/JsonWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+std::atomic<bool> Trace::enabledFlag{false};
+thread_local Trace::BufferOwner Trace::threadOwner;
+
+namespace {
+
+thread_local std::string currentThreadName;
+
+}
+
+Trace& Trace::getInstance() {
+    static Trace instance;
+    return instance;
+}
+
+Trace::Trace() {
+    auto& config = ConfigManager::getInstance();
+    capacity = std::max(16, std::stoi(config.get("TRACE_BUFFER_EVENTS", "4096")));
+    enabledFlag = config.get("TRACE_ENABLED", "false") == "true";
+}
+
+void Trace::setEnabled(bool enable) {
+    enabledFlag.store(enable, std::memory_order_relaxed);
+}
+
+int64_t Trace::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Buffers are never freed, so a dump can still read a thread that has exited until its ring is reused
+Trace::ThreadBuffer& Trace::threadBuffer() {
+    if (threadOwner.buffer) return *threadOwner.buffer;
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    ThreadBuffer* buffer;
+    if (!freeBuffers.empty()) {
+        buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+    } else {
+        buffer = new ThreadBuffer();
+        buffer->events.resize(capacity);
+        buffers.push_back(buffer);
+    }
+
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    buffer->tid = nextTid++;
+    buffer->name = currentThreadName;
+    buffer->next = 0;
+    buffer->wrapped = false;
+    threadOwner.buffer = buffer;
+    return *buffer;
+}
+
+void Trace::releaseBuffer(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    freeBuffers.push_back(buffer);
+}
+
+Trace::BufferOwner::~BufferOwner() {
+    if (buffer) Trace::getInstance().releaseBuffer(buffer);
+}
+
+void Trace::record(const char* category, const char* name, int64_t startUs, int64_t durationUs, std::string detail) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    TraceEvent& event = buffer.events[buffer.next];
+    event.category = category;
+    event.name = name;
+    event.startUs = startUs;
+    event.durationUs = durationUs;
+    event.detail = std::move(detail);
+    if (++buffer.next == buffer.events.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+void Trace::setThreadName(const std::string& name) {
+    currentThreadName = name;
+    // A thread that has recorded already keeps its ring; relabel it
+    if (threadOwner.buffer) {
+        std::lock_guard<std::mutex> lock(threadOwner.buffer->mutex);
+        threadOwner.buffer->name = name;
+    }
+}
+
+std::string Trace::renderJson() {
+    std::vector<ThreadBuffer*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        snapshot = buffers;
+    }
+
+    std::string pid = std::to_string(getpid());
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&out, &first]() {
+        if (!first) out += ",";
+        first = false;
+    };
+
+    for (ThreadBuffer* buffer : snapshot) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        std::string tid = std::to_string(buffer->tid);
+
+        separator();
+        out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":\"";
+        std::string threadName = buffer->name.empty() ? "thread-" + tid : buffer->name;
+        JsonWriter::appendEscaped(out, threadName.data(), threadName.size());
+        out += "\"}}";
+
+        size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+        size_t start = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const TraceEvent& event = buffer->events[(start + i) % buffer->events.size()];
+            separator();
+            out += "{\"ph\":\"X\",\"cat\":\"";
+            out += event.category;
+            out += "\",\"name\":\"";
+            out += event.name;
+            out += "\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"ts\":" + std::to_string(event.startUs) +
+                   ",\"dur\":" + std::to_string(event.durationUs);
+            if (!event.detail.empty()) {
+                out += ",\"args\":{\"detail\":\"";
+                JsonWriter::appendEscaped(out, event.detail.data(), event.detail.size());
+                out += "\"}";
+            }
+            out += "}";
+        }
+    }
+
+    out += "]}";
+    return out;
+}
+
+void Trace::clear() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (ThreadBuffer* buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+}
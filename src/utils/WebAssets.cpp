@@ -0,0 +1,55 @@
+#include "utils/WebAssets.h"
+#include <unordered_map>
+#include <utility>
+
+#ifdef MAESTRO_EMBED_WEB
+extern const EmbeddedAsset kEmbeddedAssets[];
+extern const size_t kEmbeddedAssetCount;
+#else
+static const EmbeddedAsset* const kEmbeddedAssets = nullptr;
+static const size_t kEmbeddedAssetCount = 0;
+#endif
+
+namespace {
+
+struct AssetIndex {
+    std::unordered_map<std::string, std::pair<const EmbeddedAsset*, bool>> byUrl;
+    std::unordered_map<std::string, const EmbeddedAsset*> byPath;
+};
+
+const AssetIndex& assetIndex() {
+    static const AssetIndex index = [] {
+        AssetIndex built;
+        for (size_t i = 0; i < kEmbeddedAssetCount; ++i) {
+            const EmbeddedAsset* asset = &kEmbeddedAssets[i];
+            std::string original = "/" + std::string(asset->path);
+            built.byUrl[original] = {asset, false};
+            if (asset->url != original) {
+                built.byUrl[asset->url] = {asset, true};
+            }
+            built.byPath[asset->path] = asset;
+        }
+        return built;
+    }();
+    return index;
+}
+
+}
+
+bool WebAssets::available() {
+    return kEmbeddedAssetCount > 0;
+}
+
+const EmbeddedAsset* WebAssets::findByUrl(const std::string& url, bool& immutable) {
+    const auto& index = assetIndex();
+    auto it = index.byUrl.find(url);
+    if (it == index.byUrl.end()) return nullptr;
+    immutable = it->second.second;
+    return it->second.first;
+}
+
+const EmbeddedAsset* WebAssets::findByPath(const std::string& path) {
+    const auto& index = assetIndex();
+    auto it = index.byPath.find(path);
+    return it == index.byPath.end() ? nullptr : it->second;
+}
@@ -1,10 +1,23 @@
 #include "utils/WiFiUtils.h"
 #include "utils/ConfigManager.h"
+#include "utils/Subprocess.h"
+#include "utils/Metrics.h"
+#include "utils/Trace.h"
+#include "utils/SystemBackend.h"
+#include "utils/WpaProfiles.h"
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <regex>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <future>
+#include <cctype>
 #include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
 
 #ifdef __linux__
 #define PLATFORM_LINUX 1
@@ -12,28 +25,165 @@
 #define PLATFORM_LINUX 0
 #endif
 
+namespace {
+
+std::atomic<long> lastMaxApOutageMs{0};
+
+void recordApOutage(long outageMs) {
+    // Shows up next to the scan and subprocess spans as the window the hotspot was gone
+    if (Trace::enabled()) {
+        Trace::getInstance().record("hostapd", "ap_down", Trace::nowUs() - outageMs * 1000, outageMs * 1000);
+    }
+    Metrics::getInstance().histogram("maestro_ap_outage_seconds", "Continuous hostapd outages caused by scanning", "",
+                                     Metrics::slowOperationBuckets()).observe(outageMs / 1000.0);
+}
+
+void recordFullScanOutage(long maxOutageMs) {
+    lastMaxApOutageMs = maxOutageMs;
+    Metrics::getInstance().histogram("maestro_full_scan_max_ap_outage_seconds", "Longest hostapd outage per full scan",
+                                     "", Metrics::slowOperationBuckets()).observe(maxOutageMs / 1000.0);
+}
+
+Histogram& scanDurationHistogram(const std::string& type) {
+    return Metrics::getInstance().histogram("maestro_wifi_scan_duration_seconds", "WiFi scan duration by scan type",
+                                            "type=\"" + type + "\"", Metrics::slowOperationBuckets());
+}
+
+// Keeps the strongest sighting of each BSS across scan chunks
+void mergeScanResults(std::map<std::string, WiFiScanResult>& merged, const std::vector<WiFiScanResult>& results) {
+    for (const auto& result : results) {
+        std::string key = result.bssid.empty() ? result.ssid : result.bssid;
+        auto it = merged.find(key);
+        if (it == merged.end() || it->second.signal_strength < result.signal_strength) {
+            merged[key] = result;
+        }
+    }
+}
+
+}
+
 std::vector<WiFiScanResult> WiFiUtils::scanNetworks(bool full_scan) {
+    TraceSpan span("wifi", "scanNetworks", full_scan ? "full" : "quick");
+
     #if !PLATFORM_LINUX
     return std::vector<WiFiScanResult>();
     #endif
 
+    auto& config = ConfigManager::getInstance();
+    // Longest hostapd outage across every pass of a full scan, recorded once at the end
+    long maxOutageMs = 0;
+    if (full_scan && config.get("FULL_SCAN_MODE", "chunked") == "legacy") {
+        ScopedLatency timer(scanDurationHistogram("full_legacy"));
+        auto results = fullScanWithInterruption(maxOutageMs);
+        recordFullScanOutage(maxOutageMs);
+        return results;
+    }
+
+    // Secondary radios don't host the AP, so each sweeps every channel on its own thread while the
+    // primary does its usual scan; whatever they cover the primary can leave alone
+    struct SecondaryScan {
+        std::string interface;
+        std::vector<int> frequencies;
+        std::future<std::vector<WiFiScanResult>> results;
+        bool ok = false;
+    };
+    std::vector<SecondaryScan> secondaries;
+    std::set<int> coveredElsewhere;
+    for (const auto& interface : getSecondaryInterfaces()) {
+        SecondaryScan secondary;
+        secondary.interface = interface;
+        secondary.frequencies = getSupportedFrequencies(interface);
+        if (secondary.frequencies.empty()) continue;
+
+        coveredElsewhere.insert(secondary.frequencies.begin(), secondary.frequencies.end());
+        secondaries.push_back(std::move(secondary));
+    }
+    for (auto& secondary : secondaries) {
+        SecondaryScan* target = &secondary;
+        secondary.results = std::async(std::launch::async, [target]() {
+            ScopedLatency timer(scanDurationHistogram("secondary"));
+            return scanFrequencies(target->interface, std::vector<int>(), false, target->ok);
+        });
+    }
+
+    std::vector<WiFiScanResult> primary;
     if (full_scan) {
-        // Full scan: stop hostapd, scan all channels, restart hostapd
-        return fullScanWithInterruption();
+        // Full scan: scan the channel list in small chunks so hostapd is only ever down briefly
+        ScopedLatency timer(scanDurationHistogram("full_chunked"));
+        primary = chunkedFullScan(maxOutageMs, coveredElsewhere);
     } else {
         // Quick scan: use virtual interface (single channel, no interruption)
-        return scanWithVirtualInterface();
+        ScopedLatency timer(scanDurationHistogram("quick"));
+        primary = scanWithVirtualInterface();
+    }
+    if (secondaries.empty()) {
+        if (full_scan) recordFullScanOutage(maxOutageMs);
+        return primary;
+    }
+
+    std::map<std::string, WiFiScanResult> merged;
+    mergeScanResults(merged, primary);
+    std::set<int> missed;
+    for (auto& secondary : secondaries) {
+        mergeScanResults(merged, secondary.results.get());
+        if (!secondary.ok) {
+            missed.insert(secondary.frequencies.begin(), secondary.frequencies.end());
+        }
     }
+    for (const auto& secondary : secondaries) {
+        if (!secondary.ok) continue;
+        for (int frequency : secondary.frequencies) missed.erase(frequency);
+    }
+
+    // A secondary radio failed mid full scan; sweep the channels only it was covering with the primary after all
+    if (full_scan && !missed.empty()) {
+        std::set<int> skip;
+        for (int frequency : getSupportedFrequencies(config.get("NETWORK_INTERFACE", "wlan0"))) {
+            if (missed.count(frequency) == 0) skip.insert(frequency);
+        }
+        mergeScanResults(merged, chunkedFullScan(maxOutageMs, skip));
+    }
+    if (full_scan) {
+        recordFullScanOutage(maxOutageMs);
+    }
+
+    std::vector<WiFiScanResult> results;
+    for (const auto& entry : merged) {
+        results.push_back(entry.second);
+    }
+    std::sort(results.begin(), results.end(), [](const WiFiScanResult& a, const WiFiScanResult& b) {
+        return a.signal_strength > b.signal_strength;
+    });
+    return results;
 }
 
-std::vector<WiFiScanResult> WiFiUtils::scanFromCache() {
+std::vector<std::string> WiFiUtils::getSecondaryInterfaces() {
+    auto& config = ConfigManager::getInstance();
+    std::string primary = config.get("NETWORK_INTERFACE", "wlan0");
+
+    // SCAN_INTERFACES is a comma-separated list; the primary interface may appear in it and is skipped
+    std::vector<std::string> interfaces;
+    std::istringstream stream(config.get("SCAN_INTERFACES", ""));
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        name.erase(std::remove_if(name.begin(), name.end(), [](unsigned char c) { return std::isspace(c); }),
+                   name.end());
+        if (!name.empty() && name != primary &&
+            std::find(interfaces.begin(), interfaces.end(), name) == interfaces.end()) {
+            interfaces.push_back(name);
+        }
+    }
+    return interfaces;
+}
+
+std::vector<WiFiScanResult> WiFiUtils::scanFromCache(const std::string& path) {
     std::vector<WiFiScanResult> results;
 
     #if !PLATFORM_LINUX
     return results;
     #endif
 
-    std::ifstream cache_file("/var/cache/maestro/wifi-scan.json");
+    std::ifstream cache_file(path);
     if (!cache_file.is_open()) {
         return results;
     }
@@ -59,11 +209,12 @@ std::vector<WiFiScanResult> WiFiUtils::scanFromCache() {
 
     for (; iter != end_iter; ++iter) {
         WiFiScanResult result;
-        result.ssid = (*iter)[1];
+        // A JSON string holding iw's escaped text: undo the JSON escaping, then iw's
+        result.ssid = unescapeSsid(unescapeSsid((*iter)[1]));
         result.signal_strength = std::stoi((*iter)[2]);
         result.security = (*iter)[3];
-        // Filter out empty and hidden SSIDs (containing \x00)
-        if (!result.ssid.empty() && result.ssid.find("\\x00") == std::string::npos) {
+        // Filter out empty and hidden SSIDs (zeroed out)
+        if (!result.ssid.empty() && result.ssid.find('\0') == std::string::npos) {
             results.push_back(result);
         }
     }
@@ -72,6 +223,7 @@ std::vector<WiFiScanResult> WiFiUtils::scanFromCache() {
 }
 
 std::vector<WiFiScanResult> WiFiUtils::scanWithVirtualInterface() {
+    MAESTRO_TRACE_SPAN("wifi", "scanWithVirtualInterface");
     std::vector<WiFiScanResult> results;
 
     #if !PLATFORM_LINUX
@@ -83,86 +235,53 @@ std::vector<WiFiScanResult> WiFiUtils::scanWithVirtualInterface() {
     std::string scan_interface = interface + "_scan";
 
     // Create virtual interface for scanning if it doesn't exist
+    auto& backend = SystemBackend::get();
     bool created_vif = false;
-    if (system(("ip link show " + scan_interface + " >/dev/null 2>&1").c_str()) != 0) {
-        if (system(("iw dev " + interface + " interface add " + scan_interface + " type managed").c_str()) == 0) {
-            created_vif = true;
-            system(("ip link set " + scan_interface + " up").c_str());
-        }
-    } else {
-        system(("ip link set " + scan_interface + " up").c_str());
-    }
-
-    std::string scan_dev = (created_vif || system(("ip link show " + scan_interface + " >/dev/null 2>&1").c_str()) == 0)
-                          ? scan_interface : interface;
+    std::string scan_dev = backend.addScanInterface(interface, scan_interface, created_vif) ? scan_interface : interface;
 
-    system(("iw dev " + scan_dev + " scan > /dev/null 2>&1").c_str());
+    backend.scan(scan_dev, std::vector<int>(), false, results);
 
-    std::string command = "iw dev " + scan_dev + " scan 2>/dev/null";
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        if (created_vif) {
-            system(("iw dev " + scan_interface + " del 2>/dev/null").c_str());
-        }
-        return results;
+    if (created_vif) {
+        backend.removeInterface(scan_interface);
     }
 
-    char buffer[512];
-    std::string current_ssid;
-    int current_signal = 0;
-    std::string current_security;
+    return results;
+}
 
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        std::string line(buffer);
+std::vector<WiFiScanResult> WiFiUtils::fullScanWithInterruption(long& maxOutageMs) {
+    MAESTRO_TRACE_SPAN("wifi", "fullScanWithInterruption");
+    std::vector<WiFiScanResult> results;
 
-        if (line.find("SSID: ") != std::string::npos) {
-            size_t pos = line.find("SSID: ") + 6;
-            current_ssid = line.substr(pos);
-            if (!current_ssid.empty() && current_ssid.back() == '\n') {
-                current_ssid.pop_back();
-            }
-        }
-        else if (line.find("signal: ") != std::string::npos) {
-            size_t pos = line.find("signal: ") + 8;
-            std::string signal_str = line.substr(pos);
-            current_signal = std::stoi(signal_str);
-        }
-        else if (line.find("WPA:") != std::string::npos || line.find("RSN:") != std::string::npos) {
-            current_security = "WPA";
-        }
-        else if (line.find("BSS ") == 0 && !current_ssid.empty()) {
-            // Filter out hidden SSIDs
-            if (current_ssid.find("\\x00") == std::string::npos) {
-                WiFiScanResult result;
-                result.ssid = current_ssid;
-                result.signal_strength = std::min(100, std::max(0, (current_signal + 100) * 2));
-                result.security = current_security;
-                results.push_back(result);
-            }
-            current_ssid.clear();
-            current_signal = 0;
-            current_security.clear();
-        }
-    }
+    #if !PLATFORM_LINUX
+    return results;
+    #endif
 
-    if (!current_ssid.empty() && current_ssid.find("\\x00") == std::string::npos) {
-        WiFiScanResult result;
-        result.ssid = current_ssid;
-        result.signal_strength = std::min(100, std::max(0, (current_signal + 100) * 2));
-        result.security = current_security;
-        results.push_back(result);
-    }
+    auto& config = ConfigManager::getInstance();
+    std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
 
-    pclose(pipe);
+    // Stop hostapd services
+    auto outageStart = std::chrono::steady_clock::now();
+    Subprocess::run("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
+    usleep(500000); // Wait 0.5s for services to stop
 
-    if (created_vif) {
-        system(("iw dev " + scan_interface + " del 2>/dev/null").c_str());
-    }
+    // Bring interface up
+    Subprocess::run("ip link set " + interface + " up");
+
+    // Full channel scan
+    SystemBackend::get().scan(interface, std::vector<int>(), false, results);
+
+    // Restart hostapd
+    Subprocess::run("systemctl start maestro-hostapd maestro-dnsmasq 2>/dev/null");
+    long outageMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - outageStart).count();
+    recordApOutage(outageMs);
+    maxOutageMs = std::max(maxOutageMs, outageMs);
 
     return results;
 }
 
-std::vector<WiFiScanResult> WiFiUtils::fullScanWithInterruption() {
+std::vector<WiFiScanResult> WiFiUtils::chunkedFullScan(long& maxOutageMs, const std::set<int>& coveredElsewhere) {
+    MAESTRO_TRACE_SPAN("wifi", "chunkedFullScan");
     std::vector<WiFiScanResult> results;
 
     #if !PLATFORM_LINUX
@@ -171,79 +290,274 @@ std::vector<WiFiScanResult> WiFiUtils::fullScanWithInterruption() {
 
     auto& config = ConfigManager::getInstance();
     std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
+    size_t chunkSize = std::max(1, std::stoi(config.get("SCAN_CHUNK_CHANNELS", "3")));
+    int chunkGapMs = std::stoi(config.get("SCAN_CHUNK_GAP_MS", "1500"));
+    bool apForce = config.get("SCAN_AP_FORCE", "true") == "true";
+
+    std::vector<int> frequencies = getSupportedFrequencies(interface);
+    if (frequencies.empty()) {
+        // Channel list unavailable, nothing to chunk
+        return fullScanWithInterruption(maxOutageMs);
+    }
 
-    // Stop hostapd services
-    system("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
-    usleep(500000); // Wait 0.5s for services to stop
+    std::map<std::string, WiFiScanResult> merged;
 
-    // Bring interface up
-    system(("ip link set " + interface + " up").c_str());
+    // The AP's own channel is covered by the virtual interface, which shares it and never stops hostapd
+    int apFrequency = getOperatingFrequency(interface);
+    if (apFrequency > 0) {
+        mergeScanResults(merged, scanWithVirtualInterface());
+        frequencies.erase(std::remove(frequencies.begin(), frequencies.end(), apFrequency), frequencies.end());
+    }
+    frequencies.erase(std::remove_if(frequencies.begin(), frequencies.end(),
+                                     [&coveredElsewhere](int frequency) { return coveredElsewhere.count(frequency) > 0; }),
+                      frequencies.end());
+
+    bool interrupted = false;
+    for (size_t i = 0; i < frequencies.size(); i += chunkSize) {
+        std::vector<int> chunk(frequencies.begin() + i,
+                               frequencies.begin() + std::min(i + chunkSize, frequencies.size()));
+        bool ok = false;
+
+        // Off-channel scan while hostapd keeps beaconing, if the driver supports it
+        if (apForce) {
+            auto chunkResults = scanFrequencies(interface, chunk, true, ok);
+            if (ok) {
+                mergeScanResults(merged, chunkResults);
+                continue;
+            }
+            apForce = false;
+        }
 
-    // Full channel scan
-    system(("iw dev " + interface + " scan > /dev/null 2>&1").c_str());
+        // Give clients a moment on the restored AP before the next outage
+        if (interrupted && chunkGapMs > 0) {
+            usleep(chunkGapMs * 1000);
+        }
 
-    std::string command = "iw dev " + interface + " scan 2>/dev/null";
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        system("systemctl start maestro-hostapd maestro-dnsmasq 2>/dev/null");
-        return results;
+        auto outageStart = std::chrono::steady_clock::now();
+        Subprocess::run("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
+        Subprocess::run("ip link set " + interface + " up");
+        mergeScanResults(merged, scanFrequencies(interface, chunk, false, ok));
+        Subprocess::run("systemctl start maestro-hostapd maestro-dnsmasq 2>/dev/null");
+        interrupted = true;
+
+        long outageMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - outageStart).count();
+        recordApOutage(outageMs);
+        maxOutageMs = std::max(maxOutageMs, outageMs);
+    }
+
+    for (const auto& entry : merged) {
+        results.push_back(entry.second);
     }
+    std::sort(results.begin(), results.end(), [](const WiFiScanResult& a, const WiFiScanResult& b) {
+        return a.signal_strength > b.signal_strength;
+    });
 
-    char buffer[512];
+    return results;
+}
+
+std::vector<WiFiScanResult> WiFiUtils::scanFrequencies(const std::string& interface, const std::vector<int>& frequencies,
+                                                       bool apForce, bool& ok) {
+    TraceSpan span("wifi", "scanFrequencies", interface);
+
+    std::vector<WiFiScanResult> results;
+    ok = SystemBackend::get().scan(interface, frequencies, apForce, results);
+    if (!ok) {
+        results.clear();
+    }
+    return results;
+}
+
+std::vector<int> WiFiUtils::getSupportedFrequencies(const std::string& interface) {
+    // The channel list lives on the interface's phy
+    auto& backend = SystemBackend::get();
+    WirelessInterface info;
+    if (!backend.interfaceInfo(interface, info) || info.wiphy < 0) return std::vector<int>();
+    return backend.phyFrequencies(info.wiphy);
+}
+
+int WiFiUtils::getOperatingFrequency(const std::string& interface) {
+    // Only an interface beaconing as the AP has a channel the virtual interface can share
+    WirelessInterface info;
+    if (!SystemBackend::get().interfaceInfo(interface, info) || info.type != "AP") return 0;
+    return info.frequency;
+}
+
+LinkStats WiFiUtils::parseLinkOutput(const std::string& output) {
+    LinkStats stats;
+    std::istringstream stream(output);
+    std::string line;
+    bool inStation = false;
+
+    auto value = [&line](size_t keyLength) {
+        size_t pos = line.find_first_not_of(" \t", keyLength);
+        return pos == std::string::npos ? std::string() : line.substr(pos);
+    };
+    auto bitrate = [](const std::string& text) { return std::atof(text.c_str()); };
+
+    while (std::getline(stream, line)) {
+        if (line.find("Connected to ") == 0) {
+            stats.associated = true;
+            stats.bssid = line.substr(13, 17);
+            continue;
+        }
+        if (line.find("Station ") == 0) {
+            // Managed mode has one entry, the AP; stop before any TDLS peers
+            if (inStation) break;
+            inStation = true;
+            if (stats.bssid.empty()) stats.bssid = line.substr(8, 17);
+            continue;
+        }
+
+        size_t indent = line.find_first_not_of(" \t");
+        if (indent == std::string::npos) continue;
+        line.erase(0, indent);
+
+        if (line.find("SSID:") == 0) {
+            stats.ssid = unescapeSsid(value(5));
+        } else if (line.find("freq:") == 0) {
+            stats.frequency = std::atoi(value(5).c_str());
+        } else if (line.find("signal avg:") == 0) {
+            stats.signalAvgDbm = std::atoi(value(11).c_str());
+        } else if (line.find("signal:") == 0) {
+            stats.signalDbm = std::atoi(value(7).c_str());
+        } else if (line.find("tx bitrate:") == 0) {
+            stats.txBitrateMbps = bitrate(value(11));
+        } else if (line.find("rx bitrate:") == 0) {
+            stats.rxBitrateMbps = bitrate(value(11));
+        } else if (line.find("tx retries:") == 0) {
+            stats.txRetries = static_cast<uint32_t>(std::strtoul(value(11).c_str(), nullptr, 10));
+        } else if (line.find("tx failed:") == 0) {
+            stats.txFailed = static_cast<uint32_t>(std::strtoul(value(10).c_str(), nullptr, 10));
+        } else if (line.find("authorized:") == 0) {
+            stats.authorized = value(11) == "yes";
+        }
+    }
+    // Without "Connected to" any station entries are phones on the hotspot, not an AP
+    if (!stats.associated) return LinkStats();
+    return stats;
+}
+
+std::string WiFiUtils::unescapeSsid(const std::string& text) {
+    std::string ssid;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            ssid += text[i];
+            continue;
+        }
+        char next = text[++i];
+        switch (next) {
+            case 'e': ssid += '\x1b'; break;
+            case 'n': ssid += '\n'; break;
+            case 'r': ssid += '\r'; break;
+            case 't': ssid += '\t'; break;
+            case 'x':
+                if (i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                    std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+                    ssid += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                } else {
+                    ssid += "\\x";
+                }
+                break;
+            default: ssid += next; break; // \\ and \"
+        }
+    }
+    return ssid;
+}
+
+std::vector<WiFiScanResult> WiFiUtils::parseScanOutput(const std::string& output) {
+    std::vector<WiFiScanResult> results;
+
+    std::istringstream stream(output);
+    std::string line;
+    std::string current_bssid;
     std::string current_ssid;
     int current_signal = 0;
+    int current_frequency = 0;
     std::string current_security;
 
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        std::string line(buffer);
+    auto flush = [&]() {
+        // Filter out hidden SSIDs (zeroed out rather than empty)
+        if (!current_ssid.empty() && current_ssid.find('\0') == std::string::npos) {
+            WiFiScanResult result;
+            result.ssid = current_ssid;
+            result.signal_strength = std::min(100, std::max(0, (current_signal + 100) * 2));
+            result.security = current_security;
+            result.bssid = current_bssid;
+            result.frequency = current_frequency;
+            results.push_back(result);
+        }
+    };
 
-        if (line.find("SSID: ") != std::string::npos) {
+    while (std::getline(stream, line)) {
+        if (line.find("BSS ") == 0) {
+            flush();
+            current_bssid = line.substr(4, 17);
+            current_ssid.clear();
+            current_signal = 0;
+            current_frequency = 0;
+            current_security.clear();
+        }
+        else if (line.find("SSID: ") != std::string::npos) {
             size_t pos = line.find("SSID: ") + 6;
-            current_ssid = line.substr(pos);
-            if (!current_ssid.empty() && current_ssid.back() == '\n') {
-                current_ssid.pop_back();
-            }
+            // Raw bytes, as nl80211 hands them over, so both scan paths yield the same SSID
+            current_ssid = unescapeSsid(line.substr(pos));
         }
         else if (line.find("signal: ") != std::string::npos) {
             size_t pos = line.find("signal: ") + 8;
-            std::string signal_str = line.substr(pos);
-            current_signal = std::stoi(signal_str);
+            current_signal = std::atoi(line.c_str() + pos);
+        }
+        else if (line.find("\tfreq: ") == 0) {
+            current_frequency = std::atoi(line.c_str() + 7);
         }
         else if (line.find("WPA:") != std::string::npos || line.find("RSN:") != std::string::npos) {
             current_security = "WPA";
         }
-        else if (line.find("BSS ") == 0 && !current_ssid.empty()) {
-            // Filter out hidden SSIDs
-            if (current_ssid.find("\\x00") == std::string::npos) {
-                WiFiScanResult result;
-                result.ssid = current_ssid;
-                result.signal_strength = std::min(100, std::max(0, (current_signal + 100) * 2));
-                result.security = current_security;
-                results.push_back(result);
-            }
-            current_ssid.clear();
-            current_signal = 0;
-            current_security.clear();
-        }
     }
+    flush();
 
-    if (!current_ssid.empty() && current_ssid.find("\\x00") == std::string::npos) {
-        WiFiScanResult result;
-        result.ssid = current_ssid;
-        result.signal_strength = std::min(100, std::max(0, (current_signal + 100) * 2));
-        result.security = current_security;
-        results.push_back(result);
+    return results;
+}
+
+long WiFiUtils::getLastMaxApOutageMs() {
+    return lastMaxApOutageMs;
+}
+
+std::string WiFiUtils::derivePsk(const std::string& ssid, const std::string& passphrase) {
+    if (passphrase.size() == 64 &&
+        std::all_of(passphrase.begin(), passphrase.end(), [](unsigned char c) { return std::isxdigit(c); })) {
+        return passphrase;
+    }
+    if (passphrase.size() < 8 || passphrase.size() > 63 || ssid.empty() || ssid.size() > 32) {
+        return "";
     }
 
-    pclose(pipe);
+    static Histogram& latency = Metrics::getInstance().histogram(
+        "maestro_psk_derivation_seconds", "PBKDF2 WPA key derivation time");
+    ScopedLatency timer(latency);
+    MAESTRO_TRACE_SPAN("wifi", "derivePsk");
 
-    // Restart hostapd
-    system("systemctl start maestro-hostapd maestro-dnsmasq 2>/dev/null");
+    unsigned char key[32];
+    if (PKCS5_PBKDF2_HMAC_SHA1(passphrase.data(), static_cast<int>(passphrase.size()),
+                               reinterpret_cast<const unsigned char*>(ssid.data()), static_cast<int>(ssid.size()),
+                               4096, sizeof(key), key) != 1) {
+        return "";
+    }
 
-    return results;
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(sizeof(key) * 2);
+    for (unsigned char byte : key) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0x0f];
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    return hex;
 }
 
-bool WiFiUtils::connectToNetwork(const std::string& ssid, const std::string& password) {
+bool WiFiUtils::connectToNetwork(const std::string& ssid, const std::string& psk) {
+    MAESTRO_TRACE_SPAN("wifi", "connectToNetwork");
     #if !PLATFORM_LINUX
     return false;
     #endif
@@ -252,93 +566,146 @@ bool WiFiUtils::connectToNetwork(const std::string& ssid, const std::string& pas
     std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
 
     // Stop hotspot services
-    system("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
+    Subprocess::run("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
 
     // Bring interface down and up
-    system(("ip link set " + interface + " down").c_str());
-    system(("ip addr flush dev " + interface).c_str());
-    system(("ip link set " + interface + " up").c_str());
-
-    // Add network to wpa_supplicant
-    std::string add_network_cmd = "wpa_cli -i " + interface + " add_network 2>/dev/null";
-    FILE* pipe = popen(add_network_cmd.c_str(), "r");
-    if (!pipe) return false;
-
-    char buffer[128];
-    int network_id = -1;
-    if (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        network_id = std::stoi(buffer);
-    }
-    pclose(pipe);
+    Subprocess::run("ip link set " + interface + " down");
+    Subprocess::run("ip addr flush dev " + interface);
+    Subprocess::run("ip link set " + interface + " up");
 
+    // Reuses the SSID's profile if wpa_supplicant already has one; saved once the connect succeeds
+    int network_id = WpaProfiles::getInstance().configure(ssid, psk);
     if (network_id < 0) return false;
 
-    // Configure network
-    std::string set_ssid = "wpa_cli -i " + interface + " set_network " + std::to_string(network_id) + " ssid '\"" + ssid + "\"'";
-    std::string set_psk = "wpa_cli -i " + interface + " set_network " + std::to_string(network_id) + " psk '\"" + password + "\"'";
-    std::string enable_network = "wpa_cli -i " + interface + " enable_network " + std::to_string(network_id);
-    std::string save_config = "wpa_cli -i " + interface + " save_config";
-
-    system(set_ssid.c_str());
-    system(set_psk.c_str());
-    system(enable_network.c_str());
-    system(save_config.c_str());
+    // A failed fast reconnect leaves the supplicant disconnected, and enable_network alone doesn't undo that
+    auto& backend = SystemBackend::get();
+    backend.wpaReconnect(interface);
+    backend.wpaNetwork(interface, WpaNetworkAction::Enable, network_id);
 
     // Request DHCP
-    system(("dhclient " + interface + " 2>/dev/null &").c_str());
+    Subprocess::run("dhclient " + interface + " 2>/dev/null &");
 
     return true;
 }
 
 bool WiFiUtils::isConnected() {
+    return getWpaState() == "COMPLETED";
+}
+
+std::string WiFiUtils::getCurrentSSID() {
     #if !PLATFORM_LINUX
-    return false;
+    return "";
     #endif
 
     auto& config = ConfigManager::getInstance();
     std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
 
-    // Check if wpa_supplicant shows connected state
-    std::string command = "wpa_cli -i " + interface + " status 2>/dev/null | grep -q 'wpa_state=COMPLETED'";
-    int result = system(command.c_str());
-    return result == 0;
+    // wpa_supplicant keeps reporting the last SSID while it reassociates; only a completed link counts
+    std::map<std::string, std::string> status;
+    if (!SystemBackend::get().wpaStatus(interface, status) || status["wpa_state"] != "COMPLETED") {
+        return "";
+    }
+    return status["ssid"];
 }
 
-std::string WiFiUtils::getCurrentSSID() {
+std::string WiFiUtils::getWpaState() {
     #if !PLATFORM_LINUX
     return "";
     #endif
 
-    // Get network interface from config
     auto& config = ConfigManager::getInstance();
     std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
 
-    // Get current SSID from wpa_supplicant status
-    std::string command = "wpa_cli -i " + interface + " status 2>/dev/null | grep '^ssid=' | cut -d= -f2";
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) return "";
+    std::map<std::string, std::string> status;
+    if (!SystemBackend::get().wpaStatus(interface, status)) return "";
+    return status["wpa_state"];
+}
 
-    char buffer[256];
-    if (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        std::string ssid(buffer);
-        if (!ssid.empty() && ssid.back() == '\n') {
-            ssid.pop_back();
-        }
-        pclose(pipe);
+std::string WiFiUtils::getIpv4Address() {
+    #if !PLATFORM_LINUX
+    return "";
+    #endif
 
-        // Return empty if empty or not in completed state
-        if (ssid.empty()) {
-            return "";
-        }
+    auto& config = ConfigManager::getInstance();
+    std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
 
-        // Verify we're actually connected
-        if (!isConnected()) {
-            return "";
-        }
+    // "3: wlan0    inet 192.168.1.23/24 brd ..." per address
+    std::string output = Subprocess::capture("ip -4 -o addr show dev " + interface + " 2>/dev/null");
+    size_t inet = output.find(" inet ");
+    if (inet == std::string::npos) return "";
+    size_t start = inet + 6;
+    size_t end = output.find(' ', start);
+    return output.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+LinkStats WiFiUtils::getLinkStats() {
+    MAESTRO_TRACE_SPAN("wifi", "getLinkStats");
+    LinkStats stats;
+
+    #if !PLATFORM_LINUX
+    return stats;
+    #endif
 
-        return ssid;
+    auto& config = ConfigManager::getInstance();
+    SystemBackend::get().linkStats(config.get("NETWORK_INTERFACE", "wlan0"), stats);
+    return stats;
+}
+
+bool WiFiUtils::reconnectKnownNetwork(const std::string& ssid, const std::string& bssid, int frequency, int timeoutMs) {
+    MAESTRO_TRACE_SPAN("wifi", "reconnectKnownNetwork");
+    #if !PLATFORM_LINUX
+    return false;
+    #endif
+
+    auto& config = ConfigManager::getInstance();
+    std::string interface = config.get("NETWORK_INTERFACE", "wlan0");
+    auto& backend = SystemBackend::get();
+
+    int id = WpaProfiles::getInstance().find(ssid);
+    if (id < 0) return false;
+
+    // Stop hotspot services
+    Subprocess::run("systemctl stop maestro-dnsmasq maestro-hostapd 2>/dev/null");
+    Subprocess::run("ip link set " + interface + " up");
+
+    // Whatever the profile pinned before is put back afterwards; get_network fails for an unset field
+    std::string savedBssid;
+    std::string savedScanFreq;
+    bool hadBssid = backend.wpaGetNetwork(interface, id, "bssid", savedBssid);
+    bool hadScanFreq = backend.wpaGetNetwork(interface, id, "scan_freq", savedScanFreq);
+
+    if (!bssid.empty()) {
+        backend.wpaSetNetwork(interface, id, "bssid", bssid);
+    }
+    if (frequency > 0) {
+        backend.wpaSetNetwork(interface, id, "scan_freq", std::to_string(frequency));
     }
+    backend.wpaNetwork(interface, WpaNetworkAction::Select, id);
 
-    pclose(pipe);
-    return "";
+    bool connected = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!(connected = isConnected()) && std::chrono::steady_clock::now() < deadline) {
+        usleep(100 * 1000);
+    }
+
+    // Unpin again so roaming and a later channel change on the AP still work; "any" and an empty
+    // list are how wpa_supplicant unsets these
+    if (!bssid.empty()) {
+        backend.wpaSetNetwork(interface, id, "bssid", hadBssid ? savedBssid : "any");
+    }
+    if (frequency > 0) {
+        backend.wpaSetNetwork(interface, id, "scan_freq", hadScanFreq ? savedScanFreq : "");
+    }
+
+    if (!connected) {
+        // select_network disabled every other profile and the supplicant is still trying this one;
+        // stop it before the hotspot takes the interface back, and leave the others usable again
+        backend.wpaDisconnect(interface);
+        backend.wpaNetwork(interface, WpaNetworkAction::Enable, -1);
+        return false;
+    }
+
+    // Request DHCP
+    Subprocess::run("dhclient " + interface + " 2>/dev/null &");
+    return true;
 }
@@ -0,0 +1,240 @@
+#include "utils/WpaProfiles.h"
+#include "utils/ConfigManager.h"
+#include "utils/Logger.h"
+#include "utils/Metrics.h"
+#include "utils/SystemBackend.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+
+namespace {
+
+std::string keyDigest(const std::string& psk) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_Digest(psk.data(), psk.size(), digest, &length, EVP_sha256(), nullptr);
+    return std::string(reinterpret_cast<const char*>(digest), length);
+}
+
+// set_network takes unquoted hex for any SSID, so bytes that need escaping in quotes never matter;
+// the digest file uses it for both fields too
+std::string toHex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : bytes) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0xf];
+    }
+    return hex;
+}
+
+bool fromHex(const std::string& hex, std::string& bytes) {
+    if (hex.size() % 2 != 0) return false;
+    bytes.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char* end = nullptr;
+        std::string pair = hex.substr(i, 2);
+        long value = std::strtol(pair.c_str(), &end, 16);
+        if (*end != '\0') return false;
+        bytes += static_cast<char>(value);
+    }
+    return true;
+}
+
+}
+
+WpaProfiles& WpaProfiles::getInstance() {
+    static WpaProfiles instance;
+    return instance;
+}
+
+WpaProfiles::WpaProfiles() {
+    auto& config = ConfigManager::getInstance();
+    interface = config.get("NETWORK_INTERFACE", "wlan0");
+    digestPath = config.get("WPA_KEY_DIGEST_FILE", "/var/lib/maestro/wpa-key-digests");
+    maxProfiles = static_cast<size_t>(std::max(1, std::stoi(config.get("WPA_MAX_PROFILES", "4"))));
+
+    Metrics::getInstance().gauge("maestro_wpa_profiles", "Networks configured in wpa_supplicant", [this]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<double>(profiles.size());
+    });
+}
+
+bool WpaProfiles::load() {
+    if (loaded) return true;
+    MAESTRO_TRACE_SPAN("wifi", "loadProfiles");
+
+    std::vector<WpaNetwork> networks;
+    if (!SystemBackend::get().wpaListNetworks(interface, networks)) return false;
+
+    profiles.clear();
+    for (const auto& network : networks) {
+        auto existing = profiles.find(network.ssid);
+        if (existing == profiles.end()) {
+            profiles[network.ssid].id = network.id;
+            continue;
+        }
+        // Left behind by earlier portal versions, which added a profile per attempt; the newest wins
+        int stale = std::min(existing->second.id, network.id);
+        existing->second.id = std::max(existing->second.id, network.id);
+        MAESTRO_LOG_INFO("Removing duplicate wpa_supplicant profile {} for '{}'", stale, network.ssid);
+        removeProfile(stale);
+    }
+    loadDigests();
+    loaded = true;
+    return true;
+}
+
+// "<ssid hex> <key digest hex>" per line, rewritten whenever wpa_supplicant.conf is saved, so an
+// unchanged key is still recognised after a restart instead of costing another config write
+void WpaProfiles::loadDigests() {
+    std::ifstream file(digestPath);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string ssidHex, digestHex, ssid, digest;
+        if (!(fields >> ssidHex >> digestHex) || !fromHex(ssidHex, ssid) || !fromHex(digestHex, digest)) continue;
+        auto profile = profiles.find(ssid);
+        if (profile != profiles.end()) profile->second.keyDigest = digest;
+    }
+}
+
+void WpaProfiles::saveDigests() {
+    mkdir(digestPath.substr(0, digestPath.rfind('/')).c_str(), 0755);
+    std::string tmpPath = digestPath + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file.is_open()) {
+            MAESTRO_LOG_WARNING("Cannot write wpa_supplicant key digests {}", digestPath);
+            return;
+        }
+        chmod(tmpPath.c_str(), 0600);
+        for (const auto& profile : profiles) {
+            if (profile.second.id >= 0 && !profile.second.keyDigest.empty()) {
+                file << toHex(profile.first) << " " << toHex(profile.second.keyDigest) << "\n";
+            }
+        }
+    }
+    std::rename(tmpPath.c_str(), digestPath.c_str());
+}
+
+void WpaProfiles::removeProfile(int id) {
+    if (SystemBackend::get().wpaNetwork(interface, WpaNetworkAction::Remove, id)) {
+        unsaved = true;
+    }
+}
+
+bool WpaProfiles::discardStaged(Profile& profile) {
+    auto& backend = SystemBackend::get();
+    if (profile.staged >= 0) {
+        backend.wpaNetwork(interface, WpaNetworkAction::Remove, profile.staged);
+        profile.staged = -1;
+        profile.stagedDigest.clear();
+    }
+    if (profile.id < 0) return false;
+    backend.wpaNetwork(interface, WpaNetworkAction::Enable, profile.id);
+    return true;
+}
+
+int WpaProfiles::configure(const std::string& ssid, const std::string& psk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!load()) return -1;
+
+    std::string digest = keyDigest(psk);
+    auto existing = profiles.find(ssid);
+    if (existing != profiles.end()) {
+        // An attempt that never reached finishAttempt
+        if (existing->second.staged >= 0 && !discardStaged(existing->second)) {
+            profiles.erase(existing);
+            existing = profiles.end();
+        } else if (existing->second.keyDigest == digest) {
+            return existing->second.id;
+        }
+    }
+
+    auto& backend = SystemBackend::get();
+    int id = backend.wpaAddNetwork(interface);
+    if (id < 0) return -1;
+
+    // The derived key goes in unquoted, so neither the command line nor wpa_supplicant.conf ever sees the passphrase
+    bool configured = backend.wpaSetNetwork(interface, id, "ssid", toHex(ssid)) &&
+                      (psk.empty() ? backend.wpaSetNetwork(interface, id, "key_mgmt", "NONE")
+                                   : backend.wpaSetNetwork(interface, id, "key_mgmt", "WPA-PSK") &&
+                                         backend.wpaSetNetwork(interface, id, "psk", psk));
+    if (!configured) {
+        backend.wpaNetwork(interface, WpaNetworkAction::Remove, id);
+        return -1;
+    }
+
+    // The working key stays in place, just out of the way, until finishAttempt knows the new one works
+    Profile& profile = profiles[ssid];
+    profile.staged = id;
+    profile.stagedDigest = digest;
+    if (profile.id >= 0) backend.wpaNetwork(interface, WpaNetworkAction::Disable, profile.id);
+    return id;
+}
+
+int WpaProfiles::find(const std::string& ssid) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!load()) return -1;
+    auto existing = profiles.find(ssid);
+    return existing == profiles.end() ? -1 : existing->second.id;
+}
+
+void WpaProfiles::finishAttempt(const std::string& ssid, bool success) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto attempted = profiles.find(ssid);
+    if (attempted == profiles.end()) return;
+    Profile& profile = attempted->second;
+
+    if (!success) {
+        // The running config goes back to what wpa_supplicant.conf has, so nothing is left to save
+        if (!discardStaged(profile)) profiles.erase(attempted);
+        return;
+    }
+    if (profile.staged >= 0) {
+        if (profile.id >= 0) removeProfile(profile.id);
+        profile.id = profile.staged;
+        profile.keyDigest = profile.stagedDigest;
+        profile.staged = -1;
+        profile.stagedDigest.clear();
+        unsaved = true;
+    }
+    profile.lastConnected = ++connects;
+
+    // Least recently connected go first, then the oldest (lowest id) of those unused since startup
+    if (profiles.size() > maxProfiles) {
+        std::vector<std::tuple<uint64_t, int, std::string>> byAge;
+        for (const auto& entry : profiles) {
+            if (entry.second.id < 0) continue;
+            byAge.emplace_back(entry.second.lastConnected, entry.second.id, entry.first);
+        }
+        std::sort(byAge.begin(), byAge.end());
+        for (size_t i = 0; i < byAge.size() && profiles.size() > maxProfiles; ++i) {
+            const std::string& stale = std::get<2>(byAge[i]);
+            MAESTRO_LOG_INFO("Removing old wpa_supplicant profile for '{}'", stale);
+            removeProfile(std::get<1>(byAge[i]));
+            profiles.erase(stale);
+        }
+    }
+
+    if (unsaved && SystemBackend::get().wpaSaveConfig(interface)) {
+        unsaved = false;
+        saveDigests();
+        static Counter& writes = Metrics::getInstance().counter(
+            "maestro_wpa_config_writes_total", "wpa_supplicant.conf rewrites after a changed profile");
+        writes.inc();
+    }
+}
+
+void WpaProfiles::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded = false;
+    profiles.clear();
+}
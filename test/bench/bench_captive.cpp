@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+#include "controllers/CaptivePortalController.h"
+#include <drogon/drogon.h>
+
+namespace {
+
+const char* probePaths[] = {
+    "/generate_204",
+    "/hotspot-detect.html",
+    "/connecttest.txt",
+    "/success.txt",
+    "/connectivity-check",
+    "/redirect",
+};
+
+}
+
+static void BM_CaptiveProbeDispatch(benchmark::State& state) {
+    // captiveDetect logs every probe at DEBUG through Drogon's logger
+    trantor::Logger::setLogLevel(trantor::Logger::kWarn);
+
+    CaptivePortalController controller;
+    auto req = HttpRequest::newHttpRequest();
+    req->setPath(probePaths[state.range(0)]);
+    req->addHeader("User-Agent", "Dalvik/2.1.0 (Linux; U; Android 14)");
+    state.SetLabel(probePaths[state.range(0)]);
+
+    for (auto _ : state) {
+        controller.captiveDetect(req, [](const HttpResponsePtr& resp) {
+            benchmark::DoNotOptimize(resp);
+        });
+    }
+}
+BENCHMARK(BM_CaptiveProbeDispatch)->DenseRange(0, 5);
@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include "utils/ConfigManager.h"
+
+namespace {
+
+// Roughly the size of config/maestro.conf
+void populateConfig() {
+    static bool populated = false;
+    if (populated) return;
+    auto& config = ConfigManager::getInstance();
+    const char* keys[] = {
+        "HOTSPOT_SSID", "HOTSPOT_PASSWORD", "HOTSPOT_IP", "NETWORK_INTERFACE", "FULL_SCAN_MODE",
+        "SCAN_CHUNK_CHANNELS", "SCAN_CHUNK_GAP_MS", "SCAN_AP_FORCE", "SCAN_SIGNAL_ALPHA", "SCAN_MAX_MISSES",
+        "SCAN_MAX_AGE_SEC", "SERVER_PORT", "HOME_ASSISTANT_URL", "DOCKER_COMPOSE_PATH",
+        "HOME_ASSISTANT_SERVICE_NAME", "HOME_ASSISTANT_PORT", "INSTALL_DIR", "ENABLE_HARDWARE_SECURITY",
+        "LICENSE_SERVER_URL", "LOG_LEVEL", "LOG_PATH",
+    };
+    for (const char* key : keys) {
+        config.set(key, "value");
+    }
+    populated = true;
+}
+
+}
+
+static void BM_ConfigGetHit(benchmark::State& state) {
+    populateConfig();
+    auto& config = ConfigManager::getInstance();
+    for (auto _ : state) {
+        std::string value = config.get("NETWORK_INTERFACE", "wlan0");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_ConfigGetHit)->ThreadRange(1, 4);
+
+static void BM_ConfigGetMissWithDefault(benchmark::State& state) {
+    populateConfig();
+    auto& config = ConfigManager::getInstance();
+    for (auto _ : state) {
+        std::string value = config.get("HOTSPOT_SERVICE_NAME", "maestro-hotspot.service");
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_ConfigGetMissWithDefault)->ThreadRange(1, 4);
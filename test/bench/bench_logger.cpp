@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include "utils/Logger.h"
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+
+namespace {
+
+// Swallows the stderr copy of every log line so the console reporter stays readable
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+NullBuffer nullBuffer;
+std::streambuf* savedCerr = nullptr;
+
+void setUpLogger(const benchmark::State& state) {
+    if (state.thread_index() != 0) return;
+    static bool fileSet = false;
+    if (!fileSet) {
+        char dir[] = "/tmp/maestro-bench-logXXXXXX";
+        if (mkdtemp(dir) != nullptr) {
+            Logger::getInstance().setLogFile(std::string(dir) + "/bench.log");
+        }
+        fileSet = true;
+    }
+    savedCerr = std::cerr.rdbuf(&nullBuffer);
+}
+
+void tearDownLogger(const benchmark::State& state) {
+    if (state.thread_index() != 0) return;
+    std::cerr.rdbuf(savedCerr);
+}
+
+}
+
+static void BM_LoggerInfo(benchmark::State& state) {
+    setUpLogger(state);
+    Logger::getInstance().setLevel(Logger::INFO);
+    for (auto _ : state) {
+        Logger::getInstance().info("Starting hotspot service: maestro-hotspot.service");
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDownLogger(state);
+}
+BENCHMARK(BM_LoggerInfo)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_LoggerFilteredDebug(benchmark::State& state) {
+    setUpLogger(state);
+    Logger::getInstance().setLevel(Logger::INFO);
+    int attempt = 0;
+    for (auto _ : state) {
+        Logger::getInstance().debug("Scan attempt " + std::to_string(++attempt) + " on interface wlan0");
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDownLogger(state);
+}
+BENCHMARK(BM_LoggerFilteredDebug)->ThreadRange(1, 8)->UseRealTime();
+
+// The same filtered-out line through the macro: a level check, no string built
+static void BM_LoggerFilteredDebugMacro(benchmark::State& state) {
+    setUpLogger(state);
+    Logger::getInstance().setLevel(Logger::INFO);
+    int attempt = 0;
+    for (auto _ : state) {
+        MAESTRO_LOG_DEBUG("Scan attempt {} on interface {}", ++attempt, "wlan0");
+    }
+    benchmark::DoNotOptimize(attempt);
+    state.SetItemsProcessed(state.iterations());
+    tearDownLogger(state);
+}
+BENCHMARK(BM_LoggerFilteredDebugMacro)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_LoggerInfoFormatted(benchmark::State& state) {
+    setUpLogger(state);
+    Logger::getInstance().setLevel(Logger::INFO);
+    std::string service = "maestro-hotspot.service";
+    int result = 0;
+    for (auto _ : state) {
+        MAESTRO_LOG_INFO("Starting hotspot service: {} (attempt {})", service, ++result);
+    }
+    state.SetItemsProcessed(state.iterations());
+    tearDownLogger(state);
+}
+BENCHMARK(BM_LoggerInfoFormatted)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+#include "controllers/WiFiController.h"
+#include "utils/JsonWriter.h"
+#include <json/json.h>
+
+namespace {
+
+std::vector<WiFiNetwork> makeNetworks(int count) {
+    std::vector<WiFiNetwork> networks;
+    for (int i = 0; i < count; ++i) {
+        WiFiNetwork network;
+        network.ssid = "Network-" + std::to_string(i);
+        network.signal = 40 + i % 60;
+        network.security = (i % 4 == 0) ? "" : "WPA";
+        networks.push_back(network);
+    }
+    return networks;
+}
+
+// Same builder settings newHttpJsonResponse uses
+Json::StreamWriterBuilder compactBuilder() {
+    Json::StreamWriterBuilder builder;
+    builder["commentStyle"] = "None";
+    builder["indentation"] = "";
+    return builder;
+}
+
+}
+
+// The DOM the scan handler built before JsonWriter
+static void BM_ScanResponseJsoncpp(benchmark::State& state) {
+    auto networks = makeNetworks(static_cast<int>(state.range(0)));
+    auto builder = compactBuilder();
+
+    for (auto _ : state) {
+        Json::Value response;
+        response["status"] = "success";
+        response["scan_type"] = "cached";
+        response["version"] = "0123456789abcdef-42";
+        response["networks"] = Json::Value(Json::arrayValue);
+        for (const auto& network : networks) {
+            Json::Value networkJson;
+            networkJson["id"] = WiFiManagerService::networkId(network);
+            networkJson["ssid"] = network.ssid;
+            networkJson["signal"] = network.signal;
+            networkJson["security"] = network.security;
+            response["networks"].append(networkJson);
+        }
+        std::string body = Json::writeString(builder, response);
+        benchmark::DoNotOptimize(body);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanResponseJsoncpp)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_ScanResponseJsonWriter(benchmark::State& state) {
+    auto networks = makeNetworks(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        JsonWriter json;
+        WiFiController::writeScanResponse(json, networks, "0123456789abcdef-42");
+        benchmark::DoNotOptimize(json.str().data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ScanResponseJsonWriter)->RangeMultiplier(4)->Range(4, 256);
+
+// A small fixed-shape reply like /api/service/status, where per-response setup dominates
+static void BM_StatusResponseJsoncpp(benchmark::State& state) {
+    auto builder = compactBuilder();
+
+    for (auto _ : state) {
+        Json::Value response;
+        response["status"] = "success";
+        response["wifi_connected"] = true;
+        response["ssid"] = "HomeNetwork";
+        response["internet_connected"] = true;
+        response["message"] = "Full connectivity validated";
+        std::string body = Json::writeString(builder, response);
+        benchmark::DoNotOptimize(body);
+    }
+}
+BENCHMARK(BM_StatusResponseJsoncpp);
+
+static void BM_StatusResponseJsonWriter(benchmark::State& state) {
+    for (auto _ : state) {
+        JsonWriter json;
+        json.beginObject()
+            .field("status", "success")
+            .field("wifi_connected", true)
+            .field("ssid", std::string("HomeNetwork"))
+            .field("internet_connected", true)
+            .field("message", "Full connectivity validated")
+            .endObject();
+        benchmark::DoNotOptimize(json.str().data());
+    }
+}
+BENCHMARK(BM_StatusResponseJsonWriter);
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include "utils/WiFiUtils.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+// Shaped like `iw dev <if> scan` output from a busy 2.4 GHz band
+std::string makeIwScanOutput(int count) {
+    std::ostringstream out;
+    for (int i = 0; i < count; ++i) {
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), "02:00:00:00:%02x:%02x", (i >> 8) & 0xff, i & 0xff);
+        out << "BSS " << bssid << "(on wlan0)\n"
+            << "\tTSF: 0 usec (0d, 00:00:00)\n"
+            << "\tfreq: " << (2412 + (i % 11) * 5) << "\n"
+            << "\tbeacon interval: 100 TUs\n"
+            << "\tcapability: ESS Privacy ShortSlotTime (0x0411)\n"
+            << "\tsignal: " << -(30 + i % 60) << ".00 dBm\n"
+            << "\tlast seen: 120 ms ago\n"
+            << "\tSSID: Network-" << i << "\n"
+            << "\tSupported rates: 1.0* 2.0* 5.5* 11.0* 6.0 9.0 12.0 18.0 \n"
+            << "\tDS Parameter set: channel " << (1 + i % 11) << "\n"
+            << "\tRSN:\t * Version: 1\n"
+            << "\t\t * Group cipher: CCMP\n"
+            << "\t\t * Pairwise ciphers: CCMP\n"
+            << "\t\t * Authentication suites: PSK\n";
+    }
+    return out.str();
+}
+
+std::string makeScanCacheJson(int count) {
+    std::ostringstream out;
+    out << "{\"timestamp\":0,\"networks\":[";
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) out << ",";
+        out << "{\"ssid\":\"Network-" << i << "\",\"signal\":" << (40 + i % 60) << ",\"security\":\"WPA\"}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+}
+
+static void BM_ParseScanOutput(benchmark::State& state) {
+    std::string output = makeIwScanOutput(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        auto results = WiFiUtils::parseScanOutput(output);
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * output.size());
+}
+BENCHMARK(BM_ParseScanOutput)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_ScanFromCache(benchmark::State& state) {
+    char path[] = "/tmp/maestro-bench-cacheXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        state.SkipWithError("could not create scan cache file");
+        return;
+    }
+    close(fd);
+    std::ofstream(path) << makeScanCacheJson(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        auto results = WiFiUtils::scanFromCache(path);
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    unlink(path);
+}
+BENCHMARK(BM_ScanFromCache)->RangeMultiplier(4)->Range(4, 256);
@@ -0,0 +1,118 @@
+// Local stand-in for LICENSE_SERVER_URL: answers POST /license {"fingerprint": "..."} with a token
+// signed by a test key, so HardwareSecurityService's refresh can be exercised without the real server.
+#include <drogon/drogon.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace drogon;
+
+namespace {
+
+struct StubOptions {
+    int port = 8443;
+    std::string keyPath;
+    int days = 30;
+    bool deny = false;
+};
+
+bool parseOption(const std::string& arg, const std::string& name, std::string& value) {
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+std::string base64Url(const std::string& data) {
+    std::vector<unsigned char> encoded(4 * ((data.size() + 2) / 3) + 1);
+    int length = EVP_EncodeBlock(encoded.data(), reinterpret_cast<const unsigned char*>(data.data()),
+                                 static_cast<int>(data.size()));
+    std::string text(reinterpret_cast<const char*>(encoded.data()), length);
+    text.erase(std::remove(text.begin(), text.end(), '='), text.end());
+    std::replace(text.begin(), text.end(), '+', '-');
+    std::replace(text.begin(), text.end(), '/', '_');
+    return text;
+}
+
+std::string sign(EVP_PKEY* key, const std::string& payload) {
+    int keyType = EVP_PKEY_base_id(key);
+    const EVP_MD* digest = (keyType == EVP_PKEY_ED25519 || keyType == EVP_PKEY_ED448) ? nullptr : EVP_sha256();
+
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    size_t length = 0;
+    if (EVP_DigestSignInit(ctx.get(), nullptr, digest, nullptr, key) != 1 ||
+        EVP_DigestSign(ctx.get(), nullptr, &length, reinterpret_cast<const unsigned char*>(payload.data()),
+                       payload.size()) != 1) {
+        return "";
+    }
+    std::string signature(length, '\0');
+    if (EVP_DigestSign(ctx.get(), reinterpret_cast<unsigned char*>(&signature[0]), &length,
+                       reinterpret_cast<const unsigned char*>(payload.data()), payload.size()) != 1) {
+        return "";
+    }
+    signature.resize(length);
+    return signature;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    StubOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        if (parseOption(arg, "port", value)) options.port = std::stoi(value);
+        else if (parseOption(arg, "key", value)) options.keyPath = value;
+        else if (parseOption(arg, "days", value)) options.days = std::stoi(value);
+        else if (arg == "--deny") options.deny = true;
+        else {
+            std::cerr << "usage: maestro-license-stub --key=PRIVATE.pem [--port=P] [--days=N] [--deny]" << std::endl;
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(options.keyPath.c_str(), "r");
+    EVP_PKEY* key = file ? PEM_read_PrivateKey(file, nullptr, nullptr, nullptr) : nullptr;
+    if (file) fclose(file);
+    if (!key) {
+        std::cerr << "cannot read private key from '" << options.keyPath << "'" << std::endl;
+        return 1;
+    }
+
+    app().registerHandler("/license", [key, options](const HttpRequestPtr& req,
+                                                     std::function<void(const HttpResponsePtr&)>&& callback) {
+        auto body = req->getJsonObject();
+        if (!body || !(*body)["fingerprint"].isString()) {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(k400BadRequest);
+            callback(resp);
+            return;
+        }
+
+        int64_t now = static_cast<int64_t>(std::time(nullptr));
+        Json::Value verdict;
+        verdict["fingerprint"] = (*body)["fingerprint"].asString();
+        verdict["licensed"] = !options.deny;
+        verdict["issued"] = static_cast<Json::Int64>(now);
+        verdict["expires"] = static_cast<Json::Int64>(now + options.days * 86400LL);
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        std::string payload = Json::writeString(builder, verdict);
+
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setContentTypeCode(CT_TEXT_PLAIN);
+        resp->setBody(base64Url(payload) + "." + base64Url(sign(key, payload)));
+        callback(resp);
+    }, {Post});
+
+    std::cout << "License stub listening on port " << options.port << std::endl;
+    app().addListener("127.0.0.1", options.port).run();
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Replays the app.js setup wizard from many simulated phones against a running portal and reports
+// throughput and tail latency per route. Point it at a portal started with SYSTEM_BACKEND=simulated.
+#include <drogon/drogon.h>
+#include <trantor/net/EventLoopThread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace drogon;
+
+namespace {
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int phones = 50;
+    int loopThreads = 4;
+    double fullScanRatio = 0.1;
+    int pollIntervalMs = 2000;
+    int maxPolls = 15;
+    double timeoutSec = 60;
+    bool json = false;
+};
+
+class LatencyRecorder {
+public:
+    void record(const std::string& route, double ms, bool ok) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& entry = routes[route];
+        entry.samples.push_back(ms);
+        if (!ok) ++entry.errors;
+    }
+
+    void recordWizard(double ms, bool completed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wizardSamples.push_back(ms);
+        if (completed) ++wizardsCompleted;
+    }
+
+    void report(const LoadOptions& options, double elapsedSec) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t totalRequests = 0;
+        for (const auto& entry : routes) totalRequests += entry.second.samples.size();
+
+        if (options.json) {
+            std::cout << "{\"phones\":" << options.phones << ",\"elapsed_sec\":" << elapsedSec
+                      << ",\"requests\":" << totalRequests << ",\"requests_per_sec\":" << totalRequests / elapsedSec
+                      << ",\"wizards_completed\":" << wizardsCompleted << ",\"wizard_ms\":" << summary(wizardSamples)
+                      << ",\"routes\":{";
+            bool first = true;
+            for (auto& entry : routes) {
+                if (!first) std::cout << ",";
+                first = false;
+                std::cout << "\"" << entry.first << "\":{\"errors\":" << entry.second.errors
+                          << ",\"latency_ms\":" << summary(entry.second.samples) << "}";
+            }
+            std::cout << "}}" << std::endl;
+            return;
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << options.phones << " phones, " << totalRequests << " requests in " << elapsedSec << " s ("
+                  << totalRequests / elapsedSec << " req/s), " << wizardsCompleted << " wizards completed\n";
+        std::cout << "wizard ms " << summary(wizardSamples) << "\n\n";
+        std::cout << std::left << std::setw(34) << "route" << std::right << std::setw(8) << "count" << std::setw(8)
+                  << "errors" << "  latency ms\n";
+        for (auto& entry : routes) {
+            std::cout << std::left << std::setw(34) << entry.first << std::right << std::setw(8)
+                      << entry.second.samples.size() << std::setw(8) << entry.second.errors << "  "
+                      << summary(entry.second.samples) << "\n";
+        }
+    }
+
+private:
+    struct Route {
+        std::vector<double> samples;
+        int errors = 0;
+    };
+
+    static std::string summary(std::vector<double>& samples) {
+        if (samples.empty()) return "{}";
+        std::sort(samples.begin(), samples.end());
+        auto pct = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << "{\"p50\":" << pct(0.50) << ",\"p90\":" << pct(0.90)
+            << ",\"p99\":" << pct(0.99) << ",\"max\":" << samples.back() << "}";
+        return out.str();
+    }
+
+    std::mutex mutex;
+    std::map<std::string, Route> routes;
+    std::vector<double> wizardSamples;
+    int wizardsCompleted = 0;
+};
+
+class Phone {
+public:
+    Phone(int id, HttpClientPtr client, LatencyRecorder& recorder, const LoadOptions& options)
+        : id(id), client(std::move(client)), recorder(recorder), options(options), random(id) {}
+
+    // Same request sequence a phone makes walking through web/static/js/app.js
+    void runWizard() {
+        auto start = std::chrono::steady_clock::now();
+
+        send(Get, "/generate_204", "GET /generate_204");
+        send(Get, "/", "GET /");
+        send(Get, "/static/css/style.css", "GET /static/css/style.css");
+        send(Get, "/static/js/app.js", "GET /static/js/app.js");
+        send(Get, "/api/wifi/status", "GET /api/wifi/status");
+
+        auto scan = send(Get, "/api/wifi/scan", "GET /api/wifi/scan");
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(random) < options.fullScanRatio) {
+            // Only queues the scan (202); the list below still comes from the cached scan
+            send(Get, "/api/wifi/scan", "GET /api/wifi/scan?full_scan", {{"full_scan", "true"}});
+        }
+
+        std::string ssid = "SimNet-0";
+        if (scan && scan->getJsonObject()) {
+            const auto& networks = (*scan->getJsonObject())["networks"];
+            if (networks.isArray() && networks.size() > 0) {
+                ssid = networks[static_cast<Json::ArrayIndex>(id % networks.size())]["ssid"].asString();
+            }
+        }
+
+        Json::Value body;
+        body["ssid"] = ssid;
+        body["password"] = "password" + std::to_string(id);
+        send(Post, "/api/wifi/connect", "POST /api/wifi/connect", {}, &body);
+
+        bool connected = false;
+        for (int poll = 0; poll < options.maxPolls && !connected; ++poll) {
+            auto status = send(Get, "/api/wifi/status", "GET /api/wifi/status (poll)");
+            if (status && status->getJsonObject()) {
+                const auto& json = *status->getJsonObject();
+                connected = json["connected"].asBool() && json["ssid"].asString() == ssid;
+            }
+            if (!connected) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.pollIntervalMs));
+            }
+        }
+
+        if (connected) {
+            send(Post, "/api/services/hotspot/shutdown", "POST /api/services/hotspot/shutdown");
+            send(Post, "/api/services/homeassistant/start", "POST /api/services/homeassistant/start");
+        }
+
+        recorder.recordWizard(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), connected);
+    }
+
+private:
+    HttpResponsePtr send(HttpMethod method, const std::string& path, const std::string& route,
+                         const std::map<std::string, std::string>& parameters = {}, const Json::Value* body = nullptr) {
+        auto req = body ? HttpRequest::newHttpJsonRequest(*body) : HttpRequest::newHttpRequest();
+        req->setMethod(method);
+        req->setPath(path);
+        req->addHeader("User-Agent", "maestro-load/1.0 (simulated phone " + std::to_string(id) + ")");
+        for (const auto& parameter : parameters) {
+            req->setParameter(parameter.first, parameter.second);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = client->sendRequest(req, options.timeoutSec);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        bool ok = result.first == ReqResult::Ok && result.second && result.second->getStatusCode() < 500;
+        recorder.record(route, ms, ok);
+        return result.first == ReqResult::Ok ? result.second : nullptr;
+    }
+
+    int id;
+    HttpClientPtr client;
+    LatencyRecorder& recorder;
+    const LoadOptions& options;
+    std::mt19937 random;
+};
+
+bool parseOption(const std::string& arg, const std::string& name, std::string& value) {
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        if (parseOption(arg, "host", value)) options.host = value;
+        else if (parseOption(arg, "port", value)) options.port = std::stoi(value);
+        else if (parseOption(arg, "phones", value)) options.phones = std::stoi(value);
+        else if (parseOption(arg, "loops", value)) options.loopThreads = std::max(1, std::stoi(value));
+        else if (parseOption(arg, "full-scan-ratio", value)) options.fullScanRatio = std::stod(value);
+        else if (parseOption(arg, "poll-ms", value)) options.pollIntervalMs = std::stoi(value);
+        else if (parseOption(arg, "max-polls", value)) options.maxPolls = std::stoi(value);
+        else if (parseOption(arg, "timeout", value)) options.timeoutSec = std::stod(value);
+        else if (arg == "--json") options.json = true;
+        else {
+            std::cerr << "usage: maestro-load [--host=H] [--port=P] [--phones=N] [--loops=N] [--full-scan-ratio=R]"
+                         " [--poll-ms=MS] [--max-polls=N] [--timeout=SEC] [--json]" << std::endl;
+            return 1;
+        }
+    }
+
+    trantor::Logger::setLogLevel(trantor::Logger::kWarn);
+
+    std::vector<std::unique_ptr<trantor::EventLoopThread>> loops;
+    for (int i = 0; i < options.loopThreads; ++i) {
+        loops.push_back(std::make_unique<trantor::EventLoopThread>("load-loop-" + std::to_string(i)));
+        loops.back()->run();
+    }
+
+    // One client per phone, like one browser keeping its own connection
+    std::string url = "http://" + options.host + ":" + std::to_string(options.port);
+    LatencyRecorder recorder;
+    std::vector<std::thread> phones;
+    auto start = std::chrono::steady_clock::now();
+    for (int id = 0; id < options.phones; ++id) {
+        auto client = HttpClient::newHttpClient(url, loops[id % loops.size()]->getLoop());
+        phones.emplace_back([id, client, &recorder, &options]() {
+            Phone(id, client, recorder, options).runWizard();
+        });
+    }
+    for (auto& phone : phones) {
+        phone.join();
+    }
+    double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    recorder.report(options, elapsedSec);
+    return 0;
+}
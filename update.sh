@@ -72,19 +72,15 @@ if [ ! -d "$INSTALL_DIR" ]; then
     $USE_SUDO mkdir -p "$INSTALL_DIR"/{bin,config,web,logs}
 fi
 
-# Stop the service if it's running
-echo -e "${YELLOW}Stopping service if running...${NC}"
-$USE_SUDO systemctl stop maestro-captive 2>/dev/null || true
-$USE_SUDO pkill -f maestro-captive 2>/dev/null || true
-sleep 1
-
-# Deploy binary
+# Deploy binary next to the running one and rename it into place, so the service keeps
+# running the old binary until it is restarted
 echo -e "${YELLOW}Deploying binary...${NC}"
-$USE_SUDO cp maestro-captive "$INSTALL_DIR/bin/" || {
+$USE_SUDO cp maestro-captive "$INSTALL_DIR/bin/maestro-captive.new" || {
     echo -e "${RED}Failed to copy binary!${NC}"
     exit 1
 }
-$USE_SUDO chmod +x "$INSTALL_DIR/bin/maestro-captive"
+$USE_SUDO chmod +x "$INSTALL_DIR/bin/maestro-captive.new"
+$USE_SUDO mv -f "$INSTALL_DIR/bin/maestro-captive.new" "$INSTALL_DIR/bin/maestro-captive"
 
 # Deploy configuration (only if it doesn't exist, to preserve user settings)
 if [ ! -f "$INSTALL_DIR/config/maestro.conf" ]; then
@@ -115,9 +111,21 @@ echo "Binary installed to: $INSTALL_DIR/bin/maestro-captive"
 echo "Configuration: $INSTALL_DIR/config/maestro.conf"
 echo "Web files: $INSTALL_DIR/web/"
 echo ""
-echo "To start the service:"
-echo "  sudo systemctl start maestro-captive"
-echo ""
-echo "Or run manually:"
-echo "  cd $INSTALL_DIR/bin && sudo ./maestro-captive"
+
+# With maestro-captive.socket holding the listener, the restart drains the old process and
+# queues new connections for the new one instead of refusing them
+if systemctl is-active --quiet maestro-captive 2>/dev/null; then
+    if ! systemctl is-active --quiet maestro-captive.socket 2>/dev/null; then
+        echo -e "${YELLOW}maestro-captive.socket is not active; requests during the restart will fail${NC}"
+    fi
+    echo -e "${YELLOW}Restarting service...${NC}"
+    $USE_SUDO systemctl restart maestro-captive
+    echo -e "${GREEN}Service restarted${NC}"
+else
+    echo "To start the service:"
+    echo "  sudo systemctl start maestro-captive.socket maestro-captive"
+    echo ""
+    echo "Or run manually:"
+    echo "  cd $INSTALL_DIR/bin && sudo ./maestro-captive"
+fi
 echo ""
\ No newline at end of file
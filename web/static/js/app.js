@@ -1,6 +1,9 @@
 let currentStep = 0;
 let selectedNetwork = null;
 let connectionCheckInterval = null;
+// Last scan list we received, so refreshes only need what changed since its version
+let scanVersion = null;
+let scanList = new Map();
 
 const steps = [
     'step-welcome',
@@ -38,6 +41,18 @@ function prevStep() {
     if (currentStep > 0) showStep(currentStep - 1);
 }
 
+// Folds a full or delta scan response into scanList and returns the list, strongest first
+function applyScanResponse(data) {
+    if (data.scan_type === 'delta') {
+        data.removed.forEach(id => scanList.delete(id));
+        data.added.concat(data.changed).forEach(network => scanList.set(network.id, network));
+    } else {
+        scanList = new Map(data.networks.map(network => [network.id, network]));
+    }
+    scanVersion = data.version || null;
+    return Array.from(scanList.values()).sort((a, b) => b.signal - a.signal);
+}
+
 async function scanWiFi(fullScan = false) {
     const wifiList = document.getElementById('wifi-list');
     const scanBtn = document.getElementById('scan-btn');
@@ -55,15 +70,22 @@ async function scanWiFi(fullScan = false) {
     }
 
     try {
-        const url = fullScan ? '/api/wifi/scan?full_scan=true' : '/api/wifi/scan';
+        if (fullScan) {
+            await waitForFullScan(wifiList, scanStatus);
+        }
+        let url = '/api/wifi/scan';
+        if (scanVersion) {
+            url += '?since=' + encodeURIComponent(scanVersion);
+        }
         const response = await fetch(url);
         const data = await response.json();
 
         if (data.status === 'success') {
+            const networks = applyScanResponse(data);
             wifiList.innerHTML = '';
-            scanStatus.textContent = `Found ${data.networks.length} networks`;
+            scanStatus.textContent = `Found ${networks.length} networks`;
 
-            if (data.networks.length === 0) {
+            if (networks.length === 0) {
                 if (!fullScan) {
                     wifiList.innerHTML = `
                         <div class="loading">
@@ -102,7 +124,7 @@ async function scanWiFi(fullScan = false) {
                 wifiList.parentElement.appendChild(rescanContainer);
             }
 
-            data.networks.forEach(network => {
+            networks.forEach(network => {
                 const wifiItem = document.createElement('div');
                 wifiItem.className = 'wifi-item';
                 wifiItem.onclick = () => selectNetwork(network);
@@ -136,6 +158,37 @@ async function scanWiFi(fullScan = false) {
     }
 }
 
+// Full scans are queued server-side until the hotspot can go down without cutting anyone off;
+// once the run completes its results arrive as an ordinary refresh
+async function waitForFullScan(wifiList, scanStatus) {
+    const response = await fetch('/api/wifi/scan?full_scan=true');
+    let state = await response.json();
+    const run = state.run;
+    let completed = 0;
+
+    while (completed < run) {
+        const seconds = Math.ceil((state.eta_ms || 0) / 1000);
+        if (state.waiting_for === 'active_stations') {
+            scanStatus.textContent = `Full scan in about ${seconds}s`;
+            wifiList.innerHTML = '<div class="loading">Waiting for other devices to finish setup...</div>';
+        } else if (state.waiting_for === 'min_interval') {
+            scanStatus.textContent = `Full scan in about ${seconds}s`;
+            wifiList.innerHTML = '<div class="loading">A full scan ran recently, next one shortly...</div>';
+        } else {
+            scanStatus.textContent = 'Scanning all channels...';
+            wifiList.innerHTML = '<div class="loading">Full scan in progress...<br>Hotspot will briefly restart</div>';
+        }
+
+        await new Promise(resolve => setTimeout(resolve, Math.min(Math.max(state.eta_ms || 0, 1000), 5000)));
+        try {
+            state = await (await fetch('/api/wifi/scan/schedule')).json();
+            completed = state.completed_runs;
+        } catch (error) {
+            // The hotspot is down while a chunk of channels is scanned; keep polling
+        }
+    }
+}
+
 async function fullRescan() {
     await scanWiFi(true);
 }
@@ -350,7 +403,13 @@ async function startHomeAssistant() {
         const response = await fetch('/api/services/homeassistant/start', { method: 'POST' });
         const data = await response.json();
 
-        if (data.status === 'success') {
+        let started = data.status === 'success';
+        if (data.status === 'accepted') {
+            // The image is still being pulled or the container created; it starts once that finishes
+            started = await waitForHomeAssistant(statusElement);
+        }
+
+        if (started) {
             statusElement.textContent = '✓ Running';
             statusElement.className = 'status connected';
             setTimeout(() => showStep(4), 2000);
@@ -367,6 +426,36 @@ async function startHomeAssistant() {
     }
 }
 
+// Polls until the container runs (true) or the pending start is dropped without it running (false)
+async function waitForHomeAssistant(statusElement) {
+    while (true) {
+        await new Promise(resolve => setTimeout(resolve, 3000));
+        let state;
+        try {
+            state = await (await fetch('/api/services/status')).json();
+        } catch (error) {
+            continue;
+        }
+
+        if (state.homeassistant) return true;
+        const prepare = state.homeassistant_prepare || {};
+        if (!prepare.start_pending) {
+            // The start may have finished between the two checks the server made; ask once more
+            const again = await (await fetch('/api/services/status')).json();
+            return again.homeassistant === true;
+        }
+
+        const seconds = Math.round((prepare.elapsed_ms || 0) / 1000);
+        if (prepare.state === 'pulling') {
+            statusElement.textContent = `⏳ Downloading Home Assistant (${seconds}s)...`;
+        } else if (prepare.state === 'creating') {
+            statusElement.textContent = `⏳ Creating Home Assistant container (${seconds}s)...`;
+        } else {
+            statusElement.textContent = '⏳ Starting Home Assistant...';
+        }
+    }
+}
+
 async function disconnectAndReset() {
     const button = event.target;
     button.disabled = true;